@@ -0,0 +1,83 @@
+#include "AsyncSearch.hh"
+#include "ChessBoard.hh"
+
+using Student::AsyncSearch;
+using Student::Search;
+using Student::SearchResult;
+using Student::ChessBoard;
+using Student::Move;
+
+AsyncSearch::AsyncSearch(ChessBoard &b, int depth, Search::Callback onIteration,
+                         std::chrono::steady_clock::time_point deadline)
+  : board(b.clone())
+{
+    search.reset(new Search(*board));
+    search->setDeadline(deadline);
+    start(depth, onIteration);
+}
+
+AsyncSearch::AsyncSearch(ChessBoard &b, const Move &expected, int depth, Search::Callback onIteration)
+  : board(b.clone())
+{
+    search.reset(new Search(*board));
+    if (!board->movePiece(expected.fromRow, expected.fromColumn, expected.toRow, expected.toColumn)) {
+        finished = true;
+        return;
+    }
+    pondering = true;
+    start(depth, onIteration);
+}
+
+AsyncSearch::~AsyncSearch()
+{
+    stop();
+    if (worker.joinable()) worker.join();
+}
+
+void AsyncSearch::start(int depth, Search::Callback onIteration)
+{
+    worker = std::thread([this, depth, onIteration]() {
+        SearchResult r = search->search(depth, onIteration);
+        std::lock_guard<std::mutex> lock(mutex);
+        result = r;
+        finished = true;
+        finishedCondition.notify_all();
+    });
+}
+
+void AsyncSearch::stop()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!finished) search->stop();
+}
+
+void AsyncSearch::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+    search->setDeadline(deadline);
+}
+
+void AsyncSearch::ponderHit(std::chrono::steady_clock::time_point deadline)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pondering = false;
+    search->setDeadline(deadline);
+}
+
+bool AsyncSearch::isPondering()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pondering;
+}
+
+bool AsyncSearch::isFinished()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished;
+}
+
+SearchResult AsyncSearch::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    finishedCondition.wait(lock, [this]() { return finished; });
+    return result;
+}
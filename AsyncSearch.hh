@@ -0,0 +1,120 @@
+#ifndef __ASYNCSEARCH_H__
+#define __ASYNCSEARCH_H__
+
+#include "Search.hh"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Handle to a search running on a background thread.
+     * The search works on a private copy of the board, so the caller's board
+     * stays free to use. Every completed iteration is reported through a
+     * callback (on the search thread); stop() takes effect at the next node,
+     * or at the next piece while a node generates moves or evaluates.
+     * Destroying the handle stops the search and waits for its thread.
+     */
+    class AsyncSearch
+    {
+    private:
+        std::unique_ptr<ChessBoard> board;
+        std::unique_ptr<Search> search;
+        std::thread worker;
+
+        std::mutex mutex;
+        std::condition_variable finishedCondition;
+        bool finished = false;
+        bool pondering = false;
+        SearchResult result;
+
+        void start(int depth, Search::Callback onIteration);
+
+    public:
+        /**
+         * @brief
+         * Starts searching the position on the board.
+         * @param board
+         * The position to search; copied, so it may change afterwards.
+         * @param depth
+         * Deepest iteration to search.
+         * @param onIteration
+         * Called after every completed iteration with depth, score, best move
+         * and nodes so far. May be empty.
+         * @param deadline
+         * Point in time at which the search stops, or time_point::max() for none.
+         */
+        AsyncSearch(ChessBoard &board, int depth, Search::Callback onIteration = Search::Callback(),
+                    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+        /**
+         * @brief
+         * Starts pondering: searches the reply to an expected opponent move
+         * while the opponent is still thinking. The search runs without a
+         * deadline until ponderHit; if the opponent plays something else,
+         * stop the handle and start a new search.
+         * @param board
+         * The position with the opponent to move; copied.
+         * @param expected
+         * The opponent move to ponder on. If it is not valid the handle
+         * finishes at once with an empty result.
+         * @param depth
+         * Deepest iteration to search.
+         * @param onIteration
+         * Called after every completed iteration. May be empty.
+         */
+        AsyncSearch(ChessBoard &board, const Move &expected, int depth,
+                    Search::Callback onIteration = Search::Callback());
+
+        ~AsyncSearch();
+        AsyncSearch(const AsyncSearch&) = delete;
+        AsyncSearch& operator=(const AsyncSearch&) = delete;
+
+        /**
+         * @brief
+         * Stops the search; the deepest completed iteration becomes the result.
+         */
+        void stop();
+
+        /**
+         * @brief
+         * Moves the deadline of the running search.
+         */
+        void setDeadline(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @brief
+         * The opponent played the pondered move: the search continues from
+         * where it is, now against a deadline.
+         */
+        void ponderHit(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @return
+         * Returns true while the handle ponders, i.e. until ponderHit.
+         */
+        bool isPondering();
+
+        /**
+         * @return
+         * Returns true once the search has finished or stopped.
+         */
+        bool isFinished();
+
+        /**
+         * @brief
+         * Blocks until the search has finished or stopped.
+         * @return
+         * The final result.
+         */
+        SearchResult wait();
+    };
+}
+
+#endif
@@ -0,0 +1,287 @@
+#include "BatchEvaluator.hh"
+#include "ChessBoard.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define BATCH_SIMD
+#endif
+
+using Student::BatchEvaluator;
+using Student::BatchGeometry;
+using Student::ChessBoard;
+using Student::ChessPiece;
+
+namespace Student
+{
+    /**
+     * @brief
+     * Masks and shifts of one board size, shared by the kernels. Square
+     * (row, column) is bit row * numCols + column.
+     */
+    struct BatchGeometry
+    {
+        static const int UnmovedPlane = 12;
+        static const int OccupancyPlane = 13;
+        static const int EnPassantPlane = 15;
+
+        struct Direction
+        {
+            // Towards higher bits when positive.
+            int shift = 0;
+            // Squares a step in this direction can land on.
+            uint64_t mask = 0;
+        };
+
+        uint64_t board = 0;
+        uint64_t firstColumn = 0;
+        uint64_t lastColumn = 0;
+        // Row from which each colour's pawns may advance two squares.
+        uint64_t startRow[2] = {};
+        // Longest distance a slider can travel.
+        int longestRay = 0;
+        // N, S, E, W, then NE, NW, SE, SW.
+        Direction directions[8];
+        Direction knightJumps[8];
+        int pieceValues[6] = {};
+    };
+}
+
+namespace
+{
+    // Squares whose column stays on the board after moving dc columns.
+    uint64_t columnsReachable(int numRows, int numCols, int dc)
+    {
+        uint64_t mask = 0;
+        for (int r = 0; r < numRows; ++r)
+            for (int c = 0; c < numCols; ++c)
+                if (c - dc >= 0 && c - dc < numCols) mask |= uint64_t(1) << (r * numCols + c);
+        return mask;
+    }
+
+    BatchGeometry::Direction makeDirection(int numRows, int numCols, uint64_t board, int dr, int dc)
+    {
+        BatchGeometry::Direction d;
+        d.shift = dr * numCols + dc;
+        d.mask = board & columnsReachable(numRows, numCols, dc);
+        return d;
+    }
+
+    uint64_t rowMask(int numRows, int numCols, int row)
+    {
+        if (row < 0 || row >= numRows) return 0;
+        uint64_t mask = 0;
+        for (int c = 0; c < numCols; ++c) mask |= uint64_t(1) << (row * numCols + c);
+        return mask;
+    }
+
+    // Same arithmetic as ChessBoard::evaluateBoard, so the scores match bit
+    // for bit.
+    float combine(int whiteMaterial, int blackMaterial, int whiteMoves, int blackMoves, bool whiteToMove)
+    {
+        float totalWhite = float(whiteMaterial) + 0.1f * float(whiteMoves);
+        float totalBlack = float(blackMaterial) + 0.1f * float(blackMoves);
+        return whiteToMove ? (totalWhite - totalBlack) : (totalBlack - totalWhite);
+    }
+
+    typedef void (*BlockFunction)(const BatchGeometry &, const uint64_t *const *, size_t, int32_t *const *,
+                                  int32_t *const *);
+
+    namespace ScalarKernel
+    {
+#define BATCH_WIDTH 1
+#include "BatchKernel.inc"
+#undef BATCH_WIDTH
+    }
+
+#ifdef BATCH_SIMD
+    // The kernels' helpers pass 512-bit vectors around; they are all inlined,
+    // so the ABI note about such arguments does not apply. GCC reports it at
+    // the end of the file, so it stays off from here on.
+#pragma GCC diagnostic ignored "-Wpsabi"
+#pragma GCC push_options
+#pragma GCC target("avx2")
+    namespace Avx2Kernel
+    {
+#define BATCH_WIDTH 4
+#include "BatchKernel.inc"
+#undef BATCH_WIDTH
+    }
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+    namespace Avx512Kernel
+    {
+#define BATCH_WIDTH 8
+#include "BatchKernel.inc"
+#undef BATCH_WIDTH
+    }
+#pragma GCC pop_options
+#endif
+
+    BlockFunction blockFunction(BatchEvaluator::Kernel kernel, int &width)
+    {
+        switch (kernel) {
+#ifdef BATCH_SIMD
+            case BatchEvaluator::AVX2:
+                width = 4;
+                return Avx2Kernel::evaluateBlock;
+            case BatchEvaluator::AVX512:
+                width = 8;
+                return Avx512Kernel::evaluateBlock;
+#endif
+            default:
+                width = 1;
+                return ScalarKernel::evaluateBlock;
+        }
+    }
+}
+
+BatchEvaluator::BatchEvaluator(int numRows, int numCols)
+  : numRows(numRows), numCols(numCols)
+{
+    if (numRows <= 0 || numCols <= 0 || numRows * numCols > 64) return;
+
+    geometry.reset(new BatchGeometry);
+    BatchGeometry &g = *geometry;
+    g.board = (numRows * numCols == 64) ? ~uint64_t(0) : (uint64_t(1) << (numRows * numCols)) - 1;
+    g.firstColumn = columnsReachable(numRows, numCols, 0) & ~columnsReachable(numRows, numCols, 1);
+    g.lastColumn = columnsReachable(numRows, numCols, 0) & ~columnsReachable(numRows, numCols, -1);
+    g.startRow[Black] = rowMask(numRows, numCols, 1);
+    g.startRow[White] = rowMask(numRows, numCols, numRows - 2);
+    g.longestRay = std::max(numRows, numCols) - 1;
+
+    const int steps[8][2] = {{-1, 0}, {1, 0}, {0, 1}, {0, -1}, {-1, 1}, {-1, -1}, {1, 1}, {1, -1}};
+    const int jumps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+    for (int i = 0; i < 8; ++i) {
+        g.directions[i] = makeDirection(numRows, numCols, g.board, steps[i][0], steps[i][1]);
+        g.knightJumps[i] = makeDirection(numRows, numCols, g.board, jumps[i][0], jumps[i][1]);
+    }
+    for (int t = 0; t < 6; ++t) g.pieceValues[t] = ChessBoard::getPieceValue(Type(t));
+}
+
+BatchEvaluator::~BatchEvaluator() {}
+
+bool BatchEvaluator::add(ChessBoard &board)
+{
+    if (!geometry || board.getNumRows() != numRows || board.getNumCols() != numCols) return false;
+
+    size_t lane = count++;
+    if (lane % Width == 0) {
+        for (std::vector<uint64_t> &plane : planes) plane.resize(lane + Width, 0);
+    }
+
+    int kings[2] = {0, 0};
+    for (int r = 0; r < numRows; ++r) {
+        for (int c = 0; c < numCols; ++c) {
+            ChessPiece *p = board.getPiece(r, c);
+            if (!p) continue;
+            uint64_t bit = uint64_t(1) << (r * numCols + c);
+            planes[p->getColor() * 6 + p->getType()][lane] |= bit;
+            planes[BatchGeometry::OccupancyPlane + p->getColor()][lane] |= bit;
+            if (!p->getHasMoved()) planes[BatchGeometry::UnmovedPlane][lane] |= bit;
+            if (p->getType() == King) ++kings[p->getColor()];
+        }
+    }
+    std::pair<int, int> enPassant = board.getEnPassantTarget();
+    if (enPassant.first != -1)
+        planes[BatchGeometry::EnPassantPlane][lane] = uint64_t(1) << (enPassant.first * numCols + enPassant.second);
+    whiteToMove.push_back(board.getTurn() == White);
+
+    // Which of several kings is in check depends on the order of the board's
+    // piece list, so such positions are left to scoreBoard. The lane is
+    // emptied so the kernels do no work for it.
+    if (kings[Black] > 1 || kings[White] > 1) {
+        for (std::vector<uint64_t> &plane : planes) plane[lane] = 0;
+        fallbacks.emplace_back(lane, board.clone());
+    }
+    return true;
+}
+
+void BatchEvaluator::clear()
+{
+    count = 0;
+    for (std::vector<uint64_t> &plane : planes) plane.clear();
+    whiteToMove.clear();
+    fallbacks.clear();
+}
+
+bool BatchEvaluator::evaluate(std::vector<float> &scores, Kernel kernel)
+{
+    if (!isSupported(kernel)) return false;
+
+    int width;
+    BlockFunction block = blockFunction(kernel, width);
+    size_t lanes = planes[0].size();
+    for (int c = 0; c < 2; ++c) {
+        material[c].resize(lanes);
+        mobility[c].resize(lanes);
+    }
+
+    const uint64_t *planeData[NumPlanes];
+    for (int i = 0; i < NumPlanes; ++i) planeData[i] = planes[i].data();
+    int32_t *const materialData[2] = {material[Black].data(), material[White].data()};
+    int32_t *const mobilityData[2] = {mobility[Black].data(), mobility[White].data()};
+    for (size_t first = 0; first < count; first += width) block(*geometry, planeData, first, materialData, mobilityData);
+
+    scores.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        scores[i] = combine(material[White][i], material[Black][i], mobility[White][i], mobility[Black][i],
+                            whiteToMove[i]);
+    }
+    for (auto &fallback : fallbacks) scores[fallback.first] = fallback.second->scoreBoard();
+    return true;
+}
+
+double BatchEvaluator::positionsPerSecond(Kernel kernel, int rounds)
+{
+    if (!isSupported(kernel) || count == 0) return 0.0;
+
+    std::vector<float> scores;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) evaluate(scores, kernel);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return elapsed.count() > 0 ? double(count) * rounds / elapsed.count() : 0.0;
+}
+
+double BatchEvaluator::scoreBoardPositionsPerSecond(const std::vector<ChessBoard *> &boards, int rounds)
+{
+    if (boards.empty()) return 0.0;
+
+    volatile float sink = 0.0f;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+        for (ChessBoard *board : boards) sink = sink + board->scoreBoard();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return elapsed.count() > 0 ? double(boards.size()) * rounds / elapsed.count() : 0.0;
+}
+
+bool BatchEvaluator::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+        case Scalar: return true;
+#ifdef BATCH_SIMD
+        case AVX2:   return __builtin_cpu_supports("avx2");
+        case AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+        default:     return false;
+    }
+}
+
+BatchEvaluator::Kernel BatchEvaluator::bestKernel()
+{
+    if (isSupported(AVX512)) return AVX512;
+    if (isSupported(AVX2)) return AVX2;
+    return Scalar;
+}
+
+const char *BatchEvaluator::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+        case AVX2:   return "avx2";
+        case AVX512: return "avx512";
+        default:     return "scalar";
+    }
+}
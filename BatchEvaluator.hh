@@ -0,0 +1,148 @@
+#ifndef __BATCHEVALUATOR_H__
+#define __BATCHEVALUATOR_H__
+
+#include "Chess.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+    struct BatchGeometry;
+
+    /**
+     * @brief
+     * Scores large batches of independent positions of one board size, for
+     * offline labelling. Positions are copied in as bitboards laid out
+     * structure-of-arrays: one array per piece colour and type, one per
+     * colour's occupancy and one of unmoved pieces, each holding a 64-bit
+     * lane per position. Material and mobility are computed for 8 positions
+     * at a time with AVX-512, 4 with AVX2 or one at a time by the scalar
+     * kernel, and combined the way scoreBoard does it, so every score equals
+     * scoreBoard() on its position.
+     * Positions with several kings of one colour are scored by scoreBoard on
+     * a copy of the board instead.
+     */
+    class BatchEvaluator
+    {
+    public:
+        enum Kernel
+        {
+            Scalar,
+            AVX2,
+            AVX512,
+        };
+
+        // Lanes are padded to a multiple of the widest kernel's width.
+        static const int Width = 8;
+
+    private:
+        int numRows;
+        int numCols;
+        // Null when the board has more than 64 squares.
+        std::unique_ptr<BatchGeometry> geometry;
+        size_t count = 0;
+        // Bitboards per lane: colour * 6 + type, then unmoved pieces, the
+        // occupancy of each colour and the en passant target.
+        static const int NumPlanes = 16;
+        std::vector<uint64_t> planes[NumPlanes];
+        std::vector<uint8_t> whiteToMove;
+        // Material and legal move counts per colour and lane, filled by the kernels.
+        std::vector<int32_t> material[2];
+        std::vector<int32_t> mobility[2];
+        // Lanes scored by scoreBoard, with their copy of the position.
+        std::vector<std::pair<size_t, std::unique_ptr<ChessBoard>>> fallbacks;
+
+    public:
+        /**
+         * @brief
+         * Creates an empty batch for boards of one size.
+         */
+        BatchEvaluator(int numRows, int numCols);
+        ~BatchEvaluator();
+
+        /**
+         * @brief
+         * Copies a position into the next lane. The board is not referenced
+         * afterwards.
+         * @return
+         * Returns false if the board's size differs from the batch's or it
+         * has more than 64 squares.
+         */
+        bool add(ChessBoard &board);
+
+        /**
+         * @brief
+         * Removes every position.
+         */
+        void clear();
+
+        /**
+         * @return
+         * Number of positions added.
+         */
+        size_t size() { return count; }
+
+        /**
+         * @return
+         * Number of positions scored by scoreBoard rather than by the kernels.
+         */
+        size_t getFallbackCount() { return fallbacks.size(); }
+
+        /**
+         * @brief
+         * Scores every position from its side to move's point of view, as
+         * scoreBoard would.
+         * @param scores
+         * Receives one score per position, in the order they were added.
+         * @param kernel
+         * The kernel to use.
+         * @return
+         * Returns false, leaving scores alone, if the CPU cannot run the kernel.
+         */
+        bool evaluate(std::vector<float> &scores, Kernel kernel);
+        bool evaluate(std::vector<float> &scores) { return evaluate(scores, bestKernel()); }
+
+        /**
+         * @brief
+         * Times evaluate over the batch.
+         * @param rounds
+         * Number of times to score the batch.
+         * @return
+         * Positions scored per second, or 0 if the CPU cannot run the kernel.
+         */
+        double positionsPerSecond(Kernel kernel, int rounds = 1);
+
+        /**
+         * @brief
+         * Times scoreBoard on each board in turn, the scalar path the batch
+         * replaces. Boards with an EvalCache attached are timed with it.
+         * @return
+         * Positions scored per second.
+         */
+        static double scoreBoardPositionsPerSecond(const std::vector<ChessBoard *> &boards, int rounds = 1);
+
+        /**
+         * @return
+         * Returns true if this build and CPU can run the kernel.
+         */
+        static bool isSupported(Kernel kernel);
+
+        /**
+         * @return
+         * The widest kernel the CPU can run.
+         */
+        static Kernel bestKernel();
+
+        /**
+         * @return
+         * The kernel's name, for reports.
+         */
+        static const char *kernelName(Kernel kernel);
+    };
+}
+
+#endif
@@ -15,5 +15,13 @@ enum Type
     Knight,
     Queen,
 };
+enum GameStatus
+{
+    InProgress,
+    Checkmate,
+    Stalemate,
+    ThreefoldRepetition,
+    FiftyMoveRule,
+};
 
 #endif
@@ -5,9 +5,16 @@
 #include "KingPiece.hh"
 #include "KnightPiece.hh"
 #include "QueenPiece.hh"
+#include "Tablebase.hh"
+#include "EvalCache.hh"
+#include "NeuralNetwork.hh"
+#include "Stats.hh"
+#include "SlidingAttacks.hh"
+#include "ThreadPool.hh"
 #include <sstream>
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 using Student::ChessBoard;
 using Student::ChessPiece;
@@ -17,6 +24,24 @@ using Student::BishopPiece;
 using Student::KingPiece;
 using Student::KnightPiece;
 using Student::QueenPiece;
+using Student::Move;
+
+namespace
+{
+    // OffBoard only needs an address no piece can have; it is never dereferenced.
+    char offBoardTag;
+    // Tasks per thread for getHighestNextScoreParallel.
+    const size_t ParallelTasksPerThread = 4;
+    // Line kind and heading of each direction of nextPiece: rows, columns,
+    // diagonals (row - column fixed), antidiagonals (row + column fixed).
+    const int DirectionLines[8] = {1, 0, 0, 1, 2, 3, 3, 2};
+    const bool DirectionForward[8] = {false, false, true, true, false, false, true, true};
+    // Boards narrower than this either way walk their lines: the bit sets
+    // would cost more to keep up than they save.
+    const int IndexedLineLength = 48;
+}
+
+ChessPiece *const ChessBoard::OffBoard = reinterpret_cast<ChessPiece *>(&offBoardTag);
 
 ChessBoard::ChessBoard(int numRow, int numCol)
 {
@@ -24,27 +49,68 @@ ChessBoard::ChessBoard(int numRow, int numCol)
     numCols = numCol;
     turn = White;
     enPassantTarget = {-1, -1};
-    board = std::vector<std::vector<ChessPiece *>>(numRows, std::vector<ChessPiece *>(numCols, nullptr));
+    stride = numCols + 2;
+    squares = std::vector<ChessPiece *>((numRows + 4) * stride, OffBoard);
+    sliding = SlidingAttacks::forBoard(numRows, numCols);
+    if (sliding) {
+        squareBits = std::vector<uint64_t>(squares.size(), 0);
+    } else if (std::min(numRows, numCols) >= IndexedLineLength) {
+        lineWords = (std::max(numRows, numCols) + 63) / 64;
+        lineBits = std::vector<uint64_t>(size_t(lineWords) * (3 * (numRows + numCols) - 2), 0);
+    }
+    for (int r = 0; r < numRows; ++r) {
+        for (int c = 0; c < numCols; ++c) {
+            squares[getSquare(r, c)] = nullptr;
+            if (!sliding) continue;
+            int bit = r * numCols + c;
+            squareBits[getSquare(r, c)] = uint64_t(1) << bit;
+            bitSquares[bit] = getSquare(r, c);
+        }
+    }
+    pieceIndex = std::vector<int>(squares.size(), -1);
+    hashSeed = (uint64_t(numRows) << 32) | uint64_t(numCols);
 }
 
 ChessBoard::~ChessBoard() {
-    for (auto& rowVec : board) {
-        for (ChessPiece*& p : rowVec) {
-            if (p != nullptr) {
-                delete p;
-                p = nullptr;
-            }
-        }
+    for (int sq : pieceSquares) {
+        delete squares[sq];
+        squares[sq] = nullptr;
+    }
+    for (auto& pool : spareQueens) {
+        for (ChessPiece* q : pool) delete q;
+    }
+}
+
+std::unique_ptr<ChessBoard> ChessBoard::clone()
+{
+    std::unique_ptr<ChessBoard> copy(new ChessBoard(numRows, numCols));
+    for (int sq : pieceSquares) {
+        ChessPiece* p = squares[sq];
+        copy->createChessPiece(p->getColor(), p->getType(), rowOf(sq), columnOf(sq));
+        copy->squares[sq]->setHasMoved(p->getHasMoved());
     }
+    copy->turn = turn;
+    copy->enPassantTarget = enPassantTarget;
+    copy->tablebase = tablebase;
+    copy->evalCache = evalCache;
+    if (network) copy->setNeuralNetwork(network);
+    copy->halfmoveClock = halfmoveClock;
+    copy->positionHistory = positionHistory;
+    return copy;
 }
 
 void ChessBoard::createChessPiece(Color col, Type ty, int startRow, int startColumn)
 {
-    if (board.at(startRow).at(startColumn) != nullptr) {
-        delete board.at(startRow).at(startColumn);
-        board.at(startRow).at(startColumn) = nullptr;
+    // A replaced piece keeps its entry in the piece list.
+    bool occupied = (getPiece(startRow, startColumn) != nullptr);
+    if (occupied) {
+        delete at(startRow, startColumn);
+        put(getSquare(startRow, startColumn), nullptr);
     }
 
+    invalidateLegalMoves();
+    resetHistory();
+    if (accumulator) accumulator->reset();
     ChessPiece* p = nullptr;
     if (ty == Pawn)        p = new PawnPiece(*this, col, startRow, startColumn);
     else if (ty == Rook)   p = new RookPiece(*this, col, startRow, startColumn);
@@ -53,7 +119,109 @@ void ChessBoard::createChessPiece(Color col, Type ty, int startRow, int startCol
     else if (ty == Knight) p = new KnightPiece(*this, col, startRow, startColumn);
     else if (ty == Queen)  p = new QueenPiece(*this, col, startRow, startColumn);
     
-    board.at(startRow).at(startColumn) = p;
+    put(getSquare(startRow, startColumn), p);
+    if (!occupied) listPiece(getSquare(startRow, startColumn));
+
+    // Every pawn may promote during a search, so keep a queen ready for each.
+    if (ty == Pawn) {
+        size_t pawns = 0;
+        for (int sq : pieceSquares) {
+            ChessPiece* q = squares[sq];
+            if (q->getType() == Pawn && q->getColor() == col) ++pawns;
+        }
+        while (spareQueens[col].size() < pawns)
+            spareQueens[col].push_back(new QueenPiece(*this, col, startRow, startColumn));
+    }
+}
+
+ChessPiece* ChessBoard::takeSpareQueen(Color c, int row, int column)
+{
+    ChessPiece* q;
+    if (spareQueens[c].empty()) {
+        q = new QueenPiece(*this, c, row, column);
+    } else {
+        q = spareQueens[c].back();
+        spareQueens[c].pop_back();
+    }
+    q->setPosition(row, column);
+    q->markAsMoved();
+    return q;
+}
+
+void ChessBoard::returnSpareQueen(ChessPiece* queen)
+{
+    spareQueens[queen->getColor()].push_back(queen);
+}
+
+void ChessBoard::removeChessPiece(int row, int column)
+{
+    ChessPiece* p = getPiece(row, column);
+    if (p) {
+        delete p;
+        put(getSquare(row, column), nullptr);
+        unlistPiece(getSquare(row, column));
+    }
+    invalidateLegalMoves();
+    resetHistory();
+    if (accumulator) accumulator->reset();
+}
+
+void ChessBoard::listPiece(int square)
+{
+    pieceIndex[square] = int(pieceSquares.size());
+    pieceSquares.push_back(square);
+}
+
+int ChessBoard::unlistPiece(int square)
+{
+    int index = pieceIndex[square];
+    int last = pieceSquares.back();
+    pieceSquares[index] = last;
+    pieceIndex[last] = index;
+    pieceSquares.pop_back();
+    return index;
+}
+
+void ChessBoard::relistPiece(int square, int index)
+{
+    if (index < int(pieceSquares.size())) {
+        int swapped = pieceSquares[index];
+        pieceIndex[swapped] = int(pieceSquares.size());
+        pieceSquares.push_back(swapped);
+    } else {
+        pieceSquares.push_back(square);
+    }
+    pieceSquares[index] = square;
+    pieceIndex[square] = index;
+}
+
+void ChessBoard::shiftPiece(int from, int to)
+{
+    int index = pieceIndex[from];
+    pieceSquares[index] = to;
+    pieceIndex[to] = index;
+}
+
+int ChessBoard::nextPiece(int row, int column, int direction)
+{
+    int kind = DirectionLines[direction];
+    int place = (kind == 0) ? column : row;
+    const uint64_t *bits = &lineBits[lineStart(kind, row, column)];
+    int word = place >> 6, found = -1;
+    if (DirectionForward[direction]) {
+        uint64_t w = bits[word] & ((~uint64_t(0) << (place & 63)) << 1);
+        while (!w && ++word < lineWords) w = bits[word];
+        if (w) found = word * 64 + __builtin_ctzll(w);
+    } else {
+        uint64_t w = bits[word] & ((uint64_t(1) << (place & 63)) - 1);
+        while (!w && --word >= 0) w = bits[word];
+        if (w) found = word * 64 + 63 - __builtin_clzll(w);
+    }
+    if (found < 0) return 0;
+    if (kind == 0) return getSquare(row, found);
+    if (kind == 1) return getSquare(found, column);
+    if (kind == 2) return getSquare(found, column + found - row);
+    return getSquare(found, column - (found - row));
 }
 
 static bool in_bounds(int r, int c, int R, int C) {
@@ -62,86 +230,136 @@ static bool in_bounds(int r, int c, int R, int C) {
 
 bool ChessBoard::isPseudoValidMove(int fromRow, int fromColumn, int toRow, int toColumn)
 {
+    STATS_COUNT(IsPseudoValidMoveCalls);
     if (!in_bounds(fromRow, fromColumn, numRows, numCols)) return false;
     if (!in_bounds(toRow, toColumn, numRows, numCols)) return false;
 
-    ChessPiece* piece = board.at(fromRow).at(fromColumn);
+    ChessPiece* piece = at(fromRow, fromColumn);
     if (piece == nullptr) return false;
     if (fromRow == toRow && fromColumn == toColumn) return false;
 
-    ChessPiece* dst = board.at(toRow).at(toColumn);
+    ChessPiece* dst = at(toRow, toColumn);
     if (dst != nullptr && dst->getColor() == piece->getColor()) return false;
 
     if (!piece->canMoveToLocation(toRow, toColumn)) return false;
 
+    // canMoveToLocation has already checked the shape.
     Type ty = piece->getType();
-    if (ty == Rook || (ty == Queen && (fromRow == toRow || fromColumn == toColumn))) {
-        int dr = (toRow > fromRow) ? 1 : (toRow < fromRow ? -1 : 0);
-        int dc = (toColumn > fromColumn) ? 1 : (toColumn < fromColumn ? -1 : 0);
-        int r = fromRow + dr;
-        int c = fromColumn + dc;
-        while (r != toRow || c != toColumn) {
-            if (board.at(r).at(c) != nullptr) return false;
-            r += dr; c += dc;
-        }
-    } else if (ty == Bishop || (ty == Queen && (fromRow != toRow && fromColumn != toColumn))) {
-        int dr = (toRow > fromRow) ? 1 : -1;
-        int dc = (toColumn > fromColumn) ? 1 : -1;
-        int r = fromRow + dr;
-        int c = fromColumn + dc;
-        while (r != toRow) {
-            if (board.at(r).at(c) != nullptr) return false;
-            r += dr; c += dc;
-        }
-    } 
+    if (ty == Rook || ty == Bishop || ty == Queen) {
+        if (!isLineClear(fromRow, fromColumn, toRow, toColumn)) return false;
+    }
 
     return true;
 }
 
+bool ChessBoard::isLineClear(int fromRow, int fromColumn, int toRow, int toColumn)
+{
+    if (sliding) {
+        int from = fromRow * numCols + fromColumn;
+        uint64_t attacks = (fromRow == toRow || fromColumn == toColumn) ? sliding->rookAttacks(from, occupancy)
+                                                                        : sliding->bishopAttacks(from, occupancy);
+        return (attacks >> (toRow * numCols + toColumn)) & 1;
+    }
+
+    int dr = (toRow > fromRow) ? 1 : (toRow < fromRow ? -1 : 0);
+    int dc = (toColumn > fromColumn) ? 1 : (toColumn < fromColumn ? -1 : 0);
+    const int directions[3][3] = {{4, 0, 5}, {1, -1, 2}, {6, 3, 7}};
+    int direction = directions[dr + 1][dc + 1];
+    if (lineWords) {
+        // The line is clear if its first piece is the target or lies beyond it.
+        int first = nextPiece(fromRow, fromColumn, direction);
+        if (first == 0) return true;
+        int distance = std::max(std::abs(rowOf(first) - fromRow), std::abs(columnOf(first) - fromColumn));
+        return distance >= std::max(std::abs(toRow - fromRow), std::abs(toColumn - fromColumn));
+    }
+
+    // Walking one step towards the target at a time reaches it.
+    int step = dr * stride + dc;
+    int target = getSquare(toRow, toColumn);
+    for (int sq = getSquare(fromRow, fromColumn) + step; sq != target; sq += step) {
+        if (squares[sq] != nullptr) return false;
+    }
+    return true;
+}
+
 bool ChessBoard::isSquareUnderAttack(int row, int column, Color byColor)
 {
-    for (int r = 0; r < numRows; ++r) {
-        for (int c = 0; c < numCols; ++c) {
-            ChessPiece* attacker = board.at(r).at(c);
-            if (!attacker) continue;
-            if (attacker->getColor() != byColor) continue;
-
-            // --- CRITICAL FIX: MANUALLY CHECK PAWN THREATS ---
-            // Pawns attack diagonals even if the square is empty.
-            // isPseudoValidMove returns false for empty diagonals, so we fail to see the threat.
-            if (attacker->getType() == Pawn) {
-                int dir = (byColor == Black) ? 1 : -1;
-                // Check if the pawn at (r,c) attacks (row, column)
-                if (r + dir == row && (c - 1 == column || c + 1 == column)) {
-                    return true;
-                }
-            } 
-            // --- STANDARD CHECK FOR OTHER PIECES ---
-            else {
-                if (isPseudoValidMove(r, c, row, column)) {
-                    return true;
-                }
-            }
+    STATS_COUNT(IsSquareUnderAttackCalls);
+    // Looks outwards from the square for each kind of attacker instead of
+    // asking every piece on the board whether it can move there.
+    const int t = getSquare(row, column);
+    const int s = stride;
+
+    // Pawns attack diagonals even if the square is empty or holds a piece of
+    // their own colour.
+    int pawnSquare = t - ((byColor == Black) ? s : -s);
+    for (int sq : {pawnSquare - 1, pawnSquare + 1}) {
+        ChessPiece* p = squares[sq];
+        if (p && p != OffBoard && p->getColor() == byColor && p->getType() == Pawn) return true;
+    }
+
+    // Other pieces cannot move onto a piece of their own colour.
+    ChessPiece* occupant = squares[t];
+    if (occupant && occupant->getColor() == byColor) return false;
+
+    const int knightSteps[8] = {-2 * s - 1, -2 * s + 1, -s - 2, -s + 2, s - 2, s + 2, 2 * s - 1, 2 * s + 1};
+    for (int step : knightSteps) {
+        ChessPiece* p = squares[t + step];
+        if (p && p != OffBoard && p->getColor() == byColor && p->getType() == Knight) return true;
+    }
+
+    const int straightSteps[4] = {-s, -1, 1, s};
+    const int diagonalSteps[4] = {-s - 1, -s + 1, s - 1, s + 1};
+    if (sliding) {
+        for (int i = 0; i < 8; ++i) {
+            int step = (i < 4) ? straightSteps[i] : diagonalSteps[i - 4];
+            ChessPiece* p = squares[t + step];
+            if (p && p != OffBoard && p->getColor() == byColor && p->getType() == King) return true;
+        }
+        // The first piece on each line is the only one that can attack.
+        int bit = row * numCols + column;
+        uint64_t straight = sliding->rookAttacks(bit, occupancy) & occupancy;
+        uint64_t diagonal = sliding->bishopAttacks(bit, occupancy) & occupancy;
+        for (; straight; straight &= straight - 1) {
+            ChessPiece* p = squares[bitSquares[__builtin_ctzll(straight)]];
+            if (p->getColor() == byColor && (p->getType() == Rook || p->getType() == Queen)) return true;
+        }
+        for (; diagonal; diagonal &= diagonal - 1) {
+            ChessPiece* p = squares[bitSquares[__builtin_ctzll(diagonal)]];
+            if (p->getColor() == byColor && (p->getType() == Bishop || p->getType() == Queen)) return true;
         }
+        return false;
+    }
+    for (int i = 0; i < 8; ++i) {
+        bool diagonal = i >= 4;
+        int step = diagonal ? diagonalSteps[i - 4] : straightSteps[i];
+        int sq = t + step;
+        if (lineWords) sq = nextPiece(row, column, i);
+        else while (squares[sq] == nullptr) sq += step;
+        ChessPiece* p = squares[sq];
+        if (p == OffBoard || p->getColor() != byColor) continue;
+        Type ty = p->getType();
+        if (ty == Queen || ty == (diagonal ? Bishop : Rook) || (ty == King && sq == t + step)) return true;
     }
     return false;
 }
 
 std::pair<int,int> ChessBoard::findKing(Color c)
 {
-    for (int r = 0; r < numRows; ++r)
-        for (int col = 0; col < numCols; ++col) {
-            ChessPiece* p = board.at(r).at(col);
-            if (p && p->getColor() == c && p->getType() == King)
-                return {r, col};
-        }
+    // The list is stale while wouldLeaveKingInCheck tries a move, hence the
+    // null check. Should a side have several kings, any one may be returned.
+    for (int sq : pieceSquares) {
+        ChessPiece* p = squares[sq];
+        if (p && p->getColor() == c && p->getType() == King) return {rowOf(sq), columnOf(sq)};
+    }
     return {-1, -1};
 }
 
 bool ChessBoard::wouldLeaveKingInCheck(int fromRow, int fromColumn, int toRow, int toColumn)
 {
-    ChessPiece* mover    = board.at(fromRow).at(fromColumn);
-    ChessPiece* captured = board.at(toRow).at(toColumn);
+    STATS_COUNT(WouldLeaveKingInCheckCalls);
+    ChessPiece* mover    = at(fromRow, fromColumn);
+    ChessPiece* captured = at(toRow, toColumn);
     Color moverColor     = mover->getColor();
     Color enemyColor     = (moverColor == White ? Black : White);
 
@@ -149,12 +367,12 @@ bool ChessBoard::wouldLeaveKingInCheck(int fromRow, int fromColumn, int toRow, i
     bool isEnPassant = (mover->getType() == Pawn && captured == nullptr && fromColumn != toColumn);
     ChessPiece* epVictim = nullptr;
     if (isEnPassant) {
-        epVictim = board.at(fromRow).at(toColumn);
-        board.at(fromRow).at(toColumn) = nullptr;
+        epVictim = at(fromRow, toColumn);
+        put(getSquare(fromRow, toColumn), nullptr);
     }
 
-    board.at(toRow).at(toColumn) = mover;
-    board.at(fromRow).at(fromColumn) = nullptr;
+    put(getSquare(toRow, toColumn), mover);
+    put(getSquare(fromRow, fromColumn), nullptr);
     int oldR = mover->getRow(), oldC = mover->getColumn();
     mover->setPosition(toRow, toColumn);
 
@@ -165,11 +383,11 @@ bool ChessBoard::wouldLeaveKingInCheck(int fromRow, int fromColumn, int toRow, i
     }
 
     mover->setPosition(oldR, oldC);
-    board.at(fromRow).at(fromColumn) = mover;
-    board.at(toRow).at(toColumn) = captured;
+    put(getSquare(fromRow, fromColumn), mover);
+    put(getSquare(toRow, toColumn), captured);
 
     if (isEnPassant) {
-        board.at(fromRow).at(toColumn) = epVictim;
+        put(getSquare(fromRow, toColumn), epVictim);
     }
 
     return inCheck;
@@ -177,14 +395,14 @@ bool ChessBoard::wouldLeaveKingInCheck(int fromRow, int fromColumn, int toRow, i
 
 bool ChessBoard::isValidCastling(int fromRow, int fromColumn, int toRow, int toColumn)
 {
-    ChessPiece* king = board.at(fromRow).at(fromColumn);
+    ChessPiece* king = at(fromRow, fromColumn);
     if (king->getHasMoved()) return false;
 
     Color enemy = (king->getColor() == White ? Black : White);
     if (isSquareUnderAttack(fromRow, fromColumn, enemy)) return false;
 
     int rookCol = (toColumn > fromColumn) ? (numCols - 1) : 0;
-    ChessPiece* rook = board.at(fromRow).at(rookCol);
+    ChessPiece* rook = at(fromRow, rookCol);
 
     if (!rook || rook->getType() != Rook || rook->getColor() != king->getColor() || rook->getHasMoved()) {
         return false;
@@ -193,7 +411,7 @@ bool ChessBoard::isValidCastling(int fromRow, int fromColumn, int toRow, int toC
     int dir = (toColumn > fromColumn) ? 1 : -1;
     // Check path obstruction
     for (int c = fromColumn + dir; c != rookCol; c += dir) {
-        if (board.at(fromRow).at(c) != nullptr) return false;
+        if (at(fromRow, c) != nullptr) return false;
     }
 
     // Check path safety (skip square and dest square)
@@ -205,9 +423,10 @@ bool ChessBoard::isValidCastling(int fromRow, int fromColumn, int toRow, int toC
 
 bool ChessBoard::isValidMove(int fromRow, int fromColumn, int toRow, int toColumn)
 {
+    STATS_COUNT(IsValidMoveCalls);
     if (!in_bounds(fromRow, fromColumn, numRows, numCols) || !in_bounds(toRow, toColumn, numRows, numCols)) return false;
     
-    ChessPiece* piece = board.at(fromRow).at(fromColumn);
+    ChessPiece* piece = at(fromRow, fromColumn);
     if (!piece) return false;
 
     if (piece->getType() == King && std::abs(toColumn - fromColumn) == 2 && fromRow == toRow) {
@@ -223,37 +442,43 @@ bool ChessBoard::isValidMove(int fromRow, int fromColumn, int toRow, int toColum
 bool ChessBoard::movePiece(int fromRow, int fromColumn, int toRow, int toColumn)
 {
     if (!isValidMove(fromRow, fromColumn, toRow, toColumn)) return false;
-    if (board.at(fromRow).at(fromColumn)->getColor() != turn) return false;
+    if (at(fromRow, fromColumn)->getColor() != turn) return false;
 
-    ChessPiece* piece = board.at(fromRow).at(fromColumn);
+    ChessPiece* piece = at(fromRow, fromColumn);
+    uint64_t previousKey = getHashKey();
+    bool irreversible = (piece->getType() == Pawn || at(toRow, toColumn) != nullptr);
 
     // Castling
     if (piece->getType() == King && std::abs(toColumn - fromColumn) == 2) {
         int rookCol = (toColumn > fromColumn) ? (numCols - 1) : 0;
         int rookDest = (toColumn > fromColumn) ? (toColumn - 1) : (toColumn + 1);
-        ChessPiece* rook = board.at(fromRow).at(rookCol);
+        ChessPiece* rook = at(fromRow, rookCol);
         if (rook) {
-            board.at(fromRow).at(rookDest) = rook;
-            board.at(fromRow).at(rookCol) = nullptr;
+            put(getSquare(fromRow, rookDest), rook);
+            put(getSquare(fromRow, rookCol), nullptr);
+            shiftPiece(getSquare(fromRow, rookCol), getSquare(fromRow, rookDest));
             rook->setPosition(fromRow, rookDest);
             rook->markAsMoved();
         }
     }
     // En Passant
-    else if (piece->getType() == Pawn && fromColumn != toColumn && board.at(toRow).at(toColumn) == nullptr) {
-        ChessPiece* victim = board.at(fromRow).at(toColumn);
+    else if (piece->getType() == Pawn && fromColumn != toColumn && at(toRow, toColumn) == nullptr) {
+        ChessPiece* victim = at(fromRow, toColumn);
         if (victim) {
             delete victim;
-            board.at(fromRow).at(toColumn) = nullptr;
+            put(getSquare(fromRow, toColumn), nullptr);
+            unlistPiece(getSquare(fromRow, toColumn));
         }
     }
 
     // Capture/Move
-    if (board.at(toRow).at(toColumn)) {
-        delete board.at(toRow).at(toColumn);
+    if (at(toRow, toColumn)) {
+        delete at(toRow, toColumn);
+        unlistPiece(getSquare(toRow, toColumn));
     }
-    board.at(toRow).at(toColumn) = piece;
-    board.at(fromRow).at(fromColumn) = nullptr;
+    put(getSquare(toRow, toColumn), piece);
+    put(getSquare(fromRow, fromColumn), nullptr);
+    shiftPiece(getSquare(fromRow, fromColumn), getSquare(toRow, toColumn));
     piece->setPosition(toRow, toColumn);
 
     // State Update
@@ -268,25 +493,505 @@ bool ChessBoard::movePiece(int fromRow, int fromColumn, int toRow, int toColumn)
     if (piece->getType() == Pawn) {
         bool promote = (piece->getColor() == White && toRow == 0) || (piece->getColor() == Black && toRow == numRows - 1);
         if (promote) {
-            Color c = piece->getColor();
-            delete board.at(toRow).at(toColumn);
-            board.at(toRow).at(toColumn) = nullptr;
-            createChessPiece(c, Queen, toRow, toColumn);
+            // Replaces the pawn in place.
+            createChessPiece(piece->getColor(), Queen, toRow, toColumn);
         }
     }
 
     turn = (turn == White ? Black : White);
+    invalidateLegalMoves();
+    if (accumulator) accumulator->reset();
+
+    // Positions before a capture or pawn move can never come back.
+    if (irreversible) {
+        halfmoveClock = 0;
+        positionHistory.clear();
+    } else {
+        ++halfmoveClock;
+        positionHistory.push_back(previousKey);
+    }
     return true;
 }
 
 bool ChessBoard::isPieceUnderThreat(int row, int column) {
     if (!in_bounds(row, column, numRows, numCols)) return false;
-    ChessPiece* p = board.at(row).at(column);
+    ChessPiece* p = at(row, column);
     if (!p) return false;
     Color enemy = (p->getColor() == White ? Black : White);
     return isSquareUnderAttack(row, column, enemy);
 }
 
+int ChessBoard::exchangeValue(int row, int column) {
+    if (!in_bounds(row, column, numRows, numCols)) return 0;
+    ChessPiece* p = at(row, column);
+    if (!p) return 0;
+    Color enemy = (p->getColor() == White ? Black : White);
+    int value = resolveExchange(getSquare(row, column), getPieceValue(p->getType()), enemy, nullptr);
+    return value > 0 ? value : 0;
+}
+
+int ChessBoard::exchangeValue(const Move &m) {
+    ChessPiece* piece = at(m.fromRow, m.fromColumn);
+    ChessPiece* victim = at(m.toRow, m.toColumn);
+    if (!piece) return 0;
+    int victimValue = victim ? getPieceValue(victim->getType()) : 0;
+    if (!victim && piece->getType() == Pawn && m.fromColumn != m.toColumn) victimValue = getPieceValue(Pawn);
+    return resolveExchange(getSquare(m.toRow, m.toColumn), victimValue, piece->getColor(), piece);
+}
+
+int ChessBoard::resolveExchange(int target, int victimValue, Color side, ChessPiece *first) {
+    const int s = stride;
+    const int steps[8] = {-s, -1, 1, s, -s - 1, -s + 1, s - 1, s + 1};
+    // Attackers along each line, nearest first. The ones behind can only
+    // capture once every piece in front of them has.
+    const int MaxLine = 16;
+    ChessPiece* lines[8][MaxLine];
+    int lineLength[8];
+    int lineNext[8] = {};
+    for (int i = 0; i < 8; ++i) {
+        bool diagonal = i >= 4;
+        int length = 0;
+        int sq = target;
+        while (length < MaxLine) {
+            if (lineWords) {
+                sq = nextPiece(rowOf(sq), columnOf(sq), i);
+            } else {
+                do sq += steps[i]; while (squares[sq] == nullptr);
+            }
+            ChessPiece* p = squares[sq];
+            if (p == OffBoard) break;
+            bool adjacent = (sq == target + steps[i]);
+            Type ty = p->getType();
+            // Black pawns capture towards higher rows, white ones towards lower.
+            bool pawnAttacks = ty == Pawn && (p->getColor() == Black ? (i == 4 || i == 5) : (i == 6 || i == 7));
+            bool attacks = ty == Queen || ty == (diagonal ? Bishop : Rook) ||
+                           (adjacent && (ty == King || pawnAttacks));
+            if (!attacks) break;
+            lines[i][length++] = p;
+        }
+        lineLength[i] = length;
+    }
+    ChessPiece* knights[8];
+    int numKnights = 0;
+    for (int step : {-2 * s - 1, -2 * s + 1, -s - 2, -s + 2, s - 2, s + 2, 2 * s - 1, 2 * s + 1}) {
+        ChessPiece* p = squares[target + step];
+        if (p && p != OffBoard && p->getType() == Knight) knights[numKnights++] = p;
+    }
+
+    // Takes the least valuable attacker of a colour out of play.
+    auto takeAttacker = [&](Color c) -> ChessPiece* {
+        int bestValue = 0, bestLine = -1, bestKnight = -1;
+        for (int i = 0; i < numKnights; ++i) {
+            if (knights[i]->getColor() == c) {
+                bestValue = getPieceValue(Knight);
+                bestKnight = i;
+                break;
+            }
+        }
+        for (int i = 0; i < 8; ++i) {
+            if (lineNext[i] == lineLength[i]) continue;
+            ChessPiece* p = lines[i][lineNext[i]];
+            int value = getPieceValue(p->getType());
+            if (p->getColor() == c && (bestValue == 0 || value < bestValue)) {
+                bestValue = value;
+                bestLine = i;
+                bestKnight = -1;
+            }
+        }
+        if (bestLine >= 0) return lines[bestLine][lineNext[bestLine]++];
+        if (bestKnight < 0) return nullptr;
+        ChessPiece* knight = knights[bestKnight];
+        knights[bestKnight] = knights[--numKnights];
+        return knight;
+    };
+
+    if (first) {
+        // The given piece leaves its line (or the knights) first.
+        for (int i = 0; i < 8; ++i)
+            if (lineNext[i] < lineLength[i] && lines[i][lineNext[i]] == first) ++lineNext[i];
+        for (int i = 0; i < numKnights; ++i)
+            if (knights[i] == first) knights[i] = knights[--numKnights];
+    } else {
+        first = takeAttacker(side);
+        if (!first) return 0;
+    }
+
+    // gain[d]: what the side making capture d has won if the other side
+    // stops there. Then each side, from the last capture back, takes the
+    // better of stopping and capturing.
+    const int MaxCaptures = 8 * MaxLine + 8;
+    int gain[MaxCaptures + 1];
+    gain[0] = victimValue;
+    int depth = 0;
+    int onSquare = getPieceValue(first->getType());
+    side = (side == White ? Black : White);
+    while (depth < MaxCaptures) {
+        ChessPiece* capturer = takeAttacker(side);
+        if (!capturer) break;
+        ++depth;
+        gain[depth] = onSquare - gain[depth - 1];
+        onSquare = getPieceValue(capturer->getType());
+        side = (side == White ? Black : White);
+    }
+    for (; depth > 0; --depth) gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
+bool ChessBoard::isInCheck() {
+    std::pair<int,int> kpos = findKing(turn);
+    if (kpos.first == -1) return false;
+    return isSquareUnderAttack(kpos.first, kpos.second, turn == White ? Black : White);
+}
+
+void ChessBoard::resetHistory() {
+    halfmoveClock = 0;
+    positionHistory.clear();
+}
+
+void ChessBoard::restoreState(Color t, std::pair<int, int> target, int clock) {
+    turn = t;
+    enPassantTarget = target;
+    resetHistory();
+    halfmoveClock = clock;
+    invalidateLegalMoves();
+    if (accumulator) accumulator->reset();
+}
+
+GameStatus ChessBoard::getGameStatus() {
+    // The history only holds positions since the last capture or pawn move.
+    // Keys include the side to move, so the other side's positions never match.
+    if (positionHistory.size() >= 4) {
+        uint64_t key = getHashKey();
+        int repeats = 0;
+        for (uint64_t earlier : positionHistory)
+            if (earlier == key && ++repeats == 2) return ThreefoldRepetition;
+    }
+
+    if (!hasValidMove(turn)) return isInCheck() ? Checkmate : Stalemate;
+    if (halfmoveClock >= 100) return FiftyMoveRule;
+    return InProgress;
+}
+
+// ----------------------------------------------------------------------------
+// MOVE GENERATION
+// ----------------------------------------------------------------------------
+
+template <typename Visit>
+void ChessBoard::forEachCandidate(int from, Visit visit)
+{
+    const int s = stride;
+    ChessPiece* p = squares[from];
+    Type ty = p->getType();
+
+    if (ty == Pawn) {
+        int forward = (p->getColor() == Black) ? s : -s;
+        for (int t : {from + forward, from + 2 * forward, from + forward - 1, from + forward + 1})
+            if (squares[t] != OffBoard) visit(t);
+        return;
+    }
+    if (ty == Knight) {
+        for (int step : {-2 * s - 1, -2 * s + 1, -s - 2, -s + 2, s - 2, s + 2, 2 * s - 1, 2 * s + 1})
+            if (squares[from + step] != OffBoard) visit(from + step);
+        return;
+    }
+    if (ty == King) {
+        // Two columns either way are castling; from a border column they
+        // land on the padding.
+        for (int step : {-s - 1, -s, -s + 1, -2, -1, 1, 2, s - 1, s, s + 1})
+            if (squares[from + step] != OffBoard) visit(from + step);
+        return;
+    }
+
+    const int steps[8] = {-s, -1, 1, s, -s - 1, -s + 1, s - 1, s + 1};
+    int first = (ty == Bishop) ? 4 : 0;
+    int last = (ty == Rook) ? 4 : 8;
+    for (int i = first; i < last; ++i) {
+        for (int t = from + steps[i]; squares[t] != OffBoard; t += steps[i]) {
+            visit(t);
+            if (squares[t] != nullptr) break;
+        }
+    }
+}
+
+// Pieces are visited in list order and candidates grouped by direction;
+// sort moves back into board order.
+static void sortMoves(std::vector<Move> &moves, size_t first) {
+    std::sort(moves.begin() + first, moves.end(), [](const Move &a, const Move &b) {
+        if (a.fromRow != b.fromRow) return a.fromRow < b.fromRow;
+        if (a.fromColumn != b.fromColumn) return a.fromColumn < b.fromColumn;
+        return a.toRow != b.toRow ? a.toRow < b.toRow : a.toColumn < b.toColumn;
+    });
+}
+
+void ChessBoard::addValidMoves(Color color, std::vector<Move> &moves) {
+    size_t first = moves.size();
+    for (int from : pieceSquares) {
+        ChessPiece* p = squares[from];
+        if (p->getColor() != color) continue;
+        if (pollInterrupt()) break;
+        int r = rowOf(from), c = columnOf(from);
+        forEachCandidate(from, [&](int to) {
+            int tr = rowOf(to), tc = columnOf(to);
+            if (isValidMove(r, c, tr, tc)) moves.push_back(Move(r, c, tr, tc));
+        });
+    }
+    sortMoves(moves, first);
+}
+
+bool ChessBoard::hasValidMove(Color color) {
+    if (legalMovesKnown[color]) return !legalMoves[color].empty();
+    for (int from : pieceSquares) {
+        if (squares[from]->getColor() != color) continue;
+        int r = rowOf(from), c = columnOf(from);
+        bool found = false;
+        forEachCandidate(from, [&](int to) {
+            if (!found) found = isValidMove(r, c, rowOf(to), columnOf(to));
+        });
+        if (found) return true;
+    }
+    return false;
+}
+
+void ChessBoard::generateLegalMoves(std::vector<Move> &moves) {
+    moves.clear();
+    addValidMoves(turn, moves);
+}
+
+const std::vector<Move> &ChessBoard::legalMovesOf(Color color) {
+    if (!legalMovesKnown[color]) {
+        legalMoves[color].clear();
+        addValidMoves(color, legalMoves[color]);
+        legalMovesKnown[color] = !interrupted;
+    }
+    return legalMoves[color];
+}
+
+const std::vector<Move> &ChessBoard::getAllLegalMoves() {
+    return legalMovesOf(turn);
+}
+
+std::vector<std::pair<int, int>> ChessBoard::getLegalMoves(int row, int column) {
+    std::vector<std::pair<int, int>> destinations;
+    if (!in_bounds(row, column, numRows, numCols)) return destinations;
+    ChessPiece* p = at(row, column);
+    if (!p) return destinations;
+
+    // A piece's moves are contiguous, since moves are listed in board order.
+    const std::vector<Move> &moves = legalMovesOf(p->getColor());
+    auto it = std::lower_bound(moves.begin(), moves.end(), std::make_pair(row, column),
+        [](const Move &m, const std::pair<int, int> &from) {
+            return m.fromRow != from.first ? m.fromRow < from.first : m.fromColumn < from.second;
+        });
+    for (; it != moves.end() && it->fromRow == row && it->fromColumn == column; ++it)
+        destinations.push_back({it->toRow, it->toColumn});
+    return destinations;
+}
+
+void ChessBoard::generateTacticalMoves(std::vector<Move> &moves) {
+    moves.clear();
+    for (int from : pieceSquares) {
+        ChessPiece* p = squares[from];
+        if (p->getColor() != turn) continue;
+        if (pollInterrupt()) break;
+        int r = rowOf(from), c = columnOf(from);
+
+        if (p->getType() == Pawn) {
+            int tr = r + ((turn == Black) ? 1 : -1);
+            if (tr < 0 || tr >= numRows) continue;
+            bool promotes = (tr == 0 || tr == numRows - 1);
+            for (int tc = c - 1; tc <= c + 1; ++tc) {
+                if (tc < 0 || tc >= numCols) continue;
+                bool captures = (tc != c && (at(tr, tc) != nullptr || enPassantTarget == std::make_pair(tr, tc)));
+                if ((promotes || captures) && isValidMove(r, c, tr, tc)) moves.push_back(Move(r, c, tr, tc));
+            }
+            continue;
+        }
+
+        forEachCandidate(from, [&](int to) {
+            ChessPiece* target = squares[to];
+            if (!target || target->getColor() == turn) return;
+            int tr = rowOf(to), tc = columnOf(to);
+            if (isValidMove(r, c, tr, tc)) moves.push_back(Move(r, c, tr, tc));
+        });
+    }
+    sortMoves(moves, 0);
+}
+
+void ChessBoard::generateQuietMoves(std::vector<Move> &moves) {
+    moves.clear();
+    for (int from : pieceSquares) {
+        ChessPiece* p = squares[from];
+        if (p->getColor() != turn) continue;
+        if (pollInterrupt()) break;
+        int r = rowOf(from), c = columnOf(from);
+        bool pawn = (p->getType() == Pawn);
+
+        forEachCandidate(from, [&](int to) {
+            ChessPiece* target = squares[to];
+            if (target && target->getColor() != turn) return;
+            int tr = rowOf(to), tc = columnOf(to);
+            // Pawns only push here, and a one-step push onto the last row is a
+            // promotion; generateTacticalMoves has the rest.
+            if (pawn && (tc != c || (std::abs(tr - r) == 1 && (tr == 0 || tr == numRows - 1)))) return;
+            if (isValidMove(r, c, tr, tc)) moves.push_back(Move(r, c, tr, tc));
+        });
+    }
+    sortMoves(moves, 0);
+}
+
+void ChessBoard::makeMove(const Move &m, MoveUndo &undo) {
+    int from = getSquare(m.fromRow, m.fromColumn);
+    int to = getSquare(m.toRow, m.toColumn);
+    ChessPiece* piece = squares[from];
+    undo.captured = squares[to];
+    undo.capturedRow = m.toRow;
+    undo.capturedColumn = m.toColumn;
+    undo.promotedPawn = nullptr;
+    undo.castleRook = nullptr;
+    undo.moverHadMoved = piece->getHasMoved();
+    undo.enPassantTarget = enPassantTarget;
+    undo.halfmoveClock = halfmoveClock;
+
+    // En Passant
+    if (piece->getType() == Pawn && m.fromColumn != m.toColumn && undo.captured == nullptr) {
+        undo.captured = at(m.fromRow, m.toColumn);
+        undo.capturedRow = m.fromRow;
+        put(getSquare(m.fromRow, m.toColumn), nullptr);
+    }
+    // Castling
+    else if (piece->getType() == King && std::abs(m.toColumn - m.fromColumn) == 2) {
+        undo.rookFromColumn = (m.toColumn > m.fromColumn) ? (numCols - 1) : 0;
+        undo.rookToColumn = (m.toColumn > m.fromColumn) ? (m.toColumn - 1) : (m.toColumn + 1);
+        ChessPiece* rook = at(m.fromRow, undo.rookFromColumn);
+        if (rook) {
+            undo.castleRook = rook;
+            undo.rookHadMoved = rook->getHasMoved();
+            put(getSquare(m.fromRow, undo.rookToColumn), rook);
+            put(getSquare(m.fromRow, undo.rookFromColumn), nullptr);
+            shiftPiece(getSquare(m.fromRow, undo.rookFromColumn), getSquare(m.fromRow, undo.rookToColumn));
+            rook->setPosition(m.fromRow, undo.rookToColumn);
+            rook->markAsMoved();
+            // On narrow boards the king may castle onto the rook's own square.
+            if (undo.captured == rook) undo.captured = nullptr;
+        }
+    }
+    halfmoveClock = (piece->getType() == Pawn || undo.captured) ? 0 : halfmoveClock + 1;
+    if (undo.captured) undo.capturedIndex = unlistPiece(getSquare(undo.capturedRow, undo.capturedColumn));
+
+    put(to, piece);
+    put(from, nullptr);
+    shiftPiece(from, to);
+    piece->setPosition(m.toRow, m.toColumn);
+    piece->markAsMoved();
+
+    if (piece->getType() == Pawn && std::abs(m.toRow - m.fromRow) == 2) {
+        enPassantTarget = {(m.fromRow + m.toRow) / 2, m.toColumn};
+    } else {
+        enPassantTarget = {-1, -1};
+    }
+
+    // Promotion
+    if (piece->getType() == Pawn && (m.toRow == 0 || m.toRow == numRows - 1)) {
+        undo.promotedPawn = piece;
+        put(to, takeSpareQueen(piece->getColor(), m.toRow, m.toColumn));
+    }
+
+    if (accumulator) {
+        // The network sees the move as the pieces that left and arrived.
+        Color mover = piece->getColor();
+        accumulator->push();
+        accumulator->removePiece(mover, piece->getType(), m.fromRow, m.fromColumn);
+        if (undo.captured)
+            accumulator->removePiece(undo.captured->getColor(), undo.captured->getType(), undo.capturedRow, undo.capturedColumn);
+        if (undo.castleRook) {
+            accumulator->removePiece(mover, Rook, m.fromRow, undo.rookFromColumn);
+            accumulator->addPiece(mover, Rook, m.fromRow, undo.rookToColumn);
+        }
+        accumulator->addPiece(mover, undo.promotedPawn ? Queen : piece->getType(), m.toRow, m.toColumn);
+    }
+
+    turn = (turn == White ? Black : White);
+    invalidateLegalMoves();
+}
+
+void ChessBoard::unmakeMove(const Move &m, const MoveUndo &undo) {
+    turn = (turn == White ? Black : White);
+
+    int from = getSquare(m.fromRow, m.fromColumn);
+    int to = getSquare(m.toRow, m.toColumn);
+    if (undo.promotedPawn) {
+        returnSpareQueen(squares[to]);
+        put(to, undo.promotedPawn);
+    }
+
+    ChessPiece* piece = squares[to];
+    piece->setPosition(m.fromRow, m.fromColumn);
+    piece->setHasMoved(undo.moverHadMoved);
+    put(from, piece);
+    put(to, nullptr);
+    shiftPiece(to, from);
+
+    if (undo.castleRook) {
+        put(getSquare(m.fromRow, undo.rookFromColumn), undo.castleRook);
+        put(getSquare(m.fromRow, undo.rookToColumn), nullptr);
+        shiftPiece(getSquare(m.fromRow, undo.rookToColumn), getSquare(m.fromRow, undo.rookFromColumn));
+        undo.castleRook->setPosition(m.fromRow, undo.rookFromColumn);
+        undo.castleRook->setHasMoved(undo.rookHadMoved);
+    }
+
+    // Last, so the piece list regains its original order.
+    if (undo.captured) {
+        int capturedSquare = getSquare(undo.capturedRow, undo.capturedColumn);
+        put(capturedSquare, undo.captured);
+        relistPiece(capturedSquare, undo.capturedIndex);
+    }
+
+    enPassantTarget = undo.enPassantTarget;
+    halfmoveClock = undo.halfmoveClock;
+    invalidateLegalMoves();
+    if (accumulator) accumulator->pop();
+}
+
+void ChessBoard::makeNullMove(MoveUndo &undo) {
+    undo.enPassantTarget = enPassantTarget;
+    undo.halfmoveClock = halfmoveClock;
+    enPassantTarget = {-1, -1};
+    ++halfmoveClock;
+    turn = (turn == White ? Black : White);
+    invalidateLegalMoves();
+}
+
+void ChessBoard::unmakeNullMove(const MoveUndo &undo) {
+    turn = (turn == White ? Black : White);
+    enPassantTarget = undo.enPassantTarget;
+    halfmoveClock = undo.halfmoveClock;
+    invalidateLegalMoves();
+}
+
+bool ChessBoard::hasNonPawnMaterial(Color c) {
+    for (int square : pieceSquares) {
+        ChessPiece* p = squares[square];
+        if (p->getColor() == c && p->getType() != Pawn && p->getType() != King) return true;
+    }
+    return false;
+}
+
+uint64_t ChessBoard::perft(int depth) {
+    if (depth <= 0) return 1;
+    std::vector<Move> moves;
+    generateLegalMoves(moves);
+    if (depth == 1) return moves.size();
+
+    uint64_t leaves = 0;
+    MoveUndo undo;
+    for (const Move &m : moves) {
+        makeMove(m, undo);
+        leaves += perft(depth - 1);
+        unmakeMove(m, undo);
+    }
+    return leaves;
+}
+
 // ----------------------------------------------------------------------------
 // SCORING
 // ----------------------------------------------------------------------------
@@ -303,35 +1008,80 @@ int ChessBoard::getPieceValue(Type t) {
     }
 }
 
+// ----------------------------------------------------------------------------
+// HASHING
+// ----------------------------------------------------------------------------
+
+// Hash features per square: 12 piece kinds, then castling right and en passant target.
+static const int CastlingFeature = 12;
+static const int EnPassantFeature = 13;
+static const int SideFeature = 14;
+
+// Zobrist-style key of one (square, feature) pair, derived with splitmix64
+// instead of a random table so every board of a size agrees on it.
+static uint64_t zobristKey(uint64_t seed, int square, int feature) {
+    uint64_t z = seed + (uint64_t(square) * 16 + feature + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t ChessBoard::getHashKey() {
+    uint64_t key = 0;
+    for (int from : pieceSquares) {
+        ChessPiece* p = squares[from];
+        int square = rowOf(from) * numCols + columnOf(from);
+        key ^= zobristKey(hashSeed, square, p->getColor() * 6 + p->getType());
+        // Unmoved kings and rooks carry the castling rights.
+        if (!p->getHasMoved() && (p->getType() == King || p->getType() == Rook))
+            key ^= zobristKey(hashSeed, square, CastlingFeature);
+    }
+    if (enPassantTarget.first != -1)
+        key ^= zobristKey(hashSeed, enPassantTarget.first * numCols + enPassantTarget.second, EnPassantFeature);
+    if (turn == Black) key ^= zobristKey(hashSeed, 0, SideFeature);
+    return key;
+}
+
 float ChessBoard::scoreBoard() {
+    STATS_COUNT(ScoreBoardCalls);
+    STATS_TIME(ScoreBoardTime);
+    if (accumulator) return accumulator->evaluate(*this);
+    if (!evalCache) return evaluateBoard();
+
+    uint64_t key = getHashKey();
+    float score;
+    if (evalCache->probe(key, score)) return score;
+    score = evaluateBoard();
+    if (!interrupted) evalCache->store(key, score);
+    return score;
+}
+
+float ChessBoard::evaluateBoard() {
     float whiteScore = 0.0f, blackScore = 0.0f;
     float whiteMoves = 0.0f, blackMoves = 0.0f;
 
-    for (int r = 0; r < numRows; ++r) {
-        for (int c = 0; c < numCols; ++c) {
-            ChessPiece* p = board[r][c];
-            if (!p) continue;
-
-            float pieceVal = getPieceValue(p->getType());
-
-            // Add piece value to respective player
-            if (p->getColor() == White) whiteScore += pieceVal;
-            else blackScore += pieceVal;
-
-            // Count legal moves for the piece (FULLY LEGAL)
-            int moveCount = 0;
-            for (int tr = 0; tr < numRows; ++tr) {
-                for (int tc = 0; tc < numCols; ++tc) {
-                    // Only fully legal moves for each piece
-                    if (isValidMove(r, c, tr, tc) && !wouldLeaveKingInCheck(r, c, tr, tc)) {
-                        moveCount++;
-                    }
-                    // Castling for king, if implemented (ensure isValidMove covers this!)
-                }
+    for (int from : pieceSquares) {
+        if (pollInterrupt()) break;
+        ChessPiece* p = squares[from];
+        int r = rowOf(from), c = columnOf(from);
+
+        float pieceVal = getPieceValue(p->getType());
+
+        // Add piece value to respective player
+        if (p->getColor() == White) whiteScore += pieceVal;
+        else blackScore += pieceVal;
+
+        // Count legal moves for the piece (FULLY LEGAL)
+        int moveCount = 0;
+        forEachCandidate(from, [&](int to) {
+            int tr = rowOf(to), tc = columnOf(to);
+            // Only fully legal moves for each piece
+            if (isValidMove(r, c, tr, tc) && !wouldLeaveKingInCheck(r, c, tr, tc)) {
+                moveCount++;
             }
-            if (p->getColor() == White) whiteMoves += moveCount;
-            else blackMoves += moveCount;
-        }
+        });
+        if (p->getColor() == White) whiteMoves += moveCount;
+        else blackMoves += moveCount;
     }
 
     // Total points: material + 0.1 per legal move
@@ -342,89 +1092,169 @@ float ChessBoard::scoreBoard() {
     return (turn == White) ? (totalWhite - totalBlack) : (totalBlack - totalWhite);
 }
 
+float ChessBoard::scoreAfterMove(int from, int to, TablebaseResult &tbResult) {
+    ChessPiece* p = squares[from];
+    int r = rowOf(from), c = columnOf(from);
+    int tr = rowOf(to), tc = columnOf(to);
+    Color opponent = (turn == White ? Black : White);
+
+    // SIMULATION
+    ChessPiece* victim = squares[to];
+    ChessPiece* enPassantVictim = nullptr;
+    int epSquare = getSquare(r, tc);
+
+    int victimIndex = -1;
+    if (victim) victimIndex = unlistPiece(to);
+
+    bool isEnPassant = (p->getType() == Pawn && victim == nullptr && c != tc);
+    if (isEnPassant) {
+        enPassantVictim = squares[epSquare];
+        put(epSquare, nullptr);
+        if (enPassantVictim) victimIndex = unlistPiece(epSquare);
+    }
+
+    put(to, p);
+    put(from, nullptr);
+    shiftPiece(from, to);
+    p->setPosition(tr, tc);
+
+    bool isPromotion = (p->getType() == Pawn && (tr == 0 || tr == numRows - 1));
+    ChessPiece* promotedPawn = nullptr;
+    if (isPromotion) {
+        promotedPawn = p;
+        put(to, takeSpareQueen(p->getColor(), tr, tc));
+    }
+
+    bool isCastling = (p->getType() == King && std::abs(tc - c) == 2);
+    ChessPiece* castleRook = nullptr;
+    int rookStartCol = -1, rookEndCol = -1;
+    if (isCastling) {
+        rookStartCol = (tc > c) ? (numCols - 1) : 0;
+        rookEndCol = (tc > c) ? (tc - 1) : (tc + 1);
+        castleRook = at(r, rookStartCol);
+        if (castleRook) {
+            put(getSquare(r, rookEndCol), castleRook);
+            put(getSquare(r, rookStartCol), nullptr);
+            shiftPiece(getSquare(r, rookStartCol), getSquare(r, rookEndCol));
+            castleRook->setPosition(r, rookEndCol);
+        }
+    }
+
+    if (accumulator) {
+        accumulator->push();
+        accumulator->removePiece(p->getColor(), p->getType(), r, c);
+        if (victim) accumulator->removePiece(victim->getColor(), victim->getType(), tr, tc);
+        if (enPassantVictim) accumulator->removePiece(enPassantVictim->getColor(), Pawn, r, tc);
+        // On narrow boards the king may land on the rook's square and be the
+        // piece shifted here, so the piece's own type is recorded.
+        if (castleRook) {
+            accumulator->removePiece(castleRook->getColor(), castleRook->getType(), r, rookStartCol);
+            accumulator->addPiece(castleRook->getColor(), castleRook->getType(), r, rookEndCol);
+        }
+        accumulator->addPiece(p->getColor(), isPromotion ? Queen : p->getType(), tr, tc);
+    }
+
+    // SCORE
+    // The table answers for the opponent, who moves next.
+    float currentScore;
+    if (tablebase && tablebase->probe(*this, opponent, tbResult)) {
+        currentScore = -tbResult.score();
+    } else {
+        currentScore = scoreBoard();
+    }
+    if (accumulator) accumulator->pop();
+
+    // UNDO
+    if (isCastling && castleRook) {
+        castleRook->setPosition(r, rookStartCol);
+        put(getSquare(r, rookStartCol), castleRook);
+        put(getSquare(r, rookEndCol), nullptr);
+        shiftPiece(getSquare(r, rookEndCol), getSquare(r, rookStartCol));
+    }
+    if (isPromotion) {
+        returnSpareQueen(squares[to]);
+        put(to, promotedPawn);
+    }
+
+    p->setPosition(r, c);
+    put(from, p);
+    put(to, victim);
+    shiftPiece(to, from);
+    if (victim) relistPiece(to, victimIndex);
+
+    if (isEnPassant && enPassantVictim) {
+        put(epSquare, enPassantVictim);
+        relistPiece(epSquare, victimIndex);
+    }
+
+    return currentScore;
+}
+
+bool ChessBoard::setNeuralNetwork(NeuralNetwork *net) {
+    if (net && (!net->isLoaded() || net->getNumRows() != numRows || net->getNumCols() != numCols)) return false;
+    network = net;
+    accumulator.reset(net ? new NeuralAccumulator(*net) : nullptr);
+    return true;
+}
+
 float ChessBoard::getHighestNextScore() {
     float maxScore = -100000.0f;
     bool moveFound = false;
-
-    for (int r = 0; r < numRows; ++r) {
-        for (int c = 0; c < numCols; ++c) {
-            ChessPiece* p = board.at(r).at(c);
-            if (!p || p->getColor() != turn) continue;
-
-            for (int tr = 0; tr < numRows; ++tr) {
-                for (int tc = 0; tc < numCols; ++tc) {
-                    if (isValidMove(r, c, tr, tc)) {
-                        moveFound = true;
-
-                        // SIMULATION
-                        ChessPiece* victim = board.at(tr).at(tc);
-                        ChessPiece* enPassantVictim = nullptr;
-                        int epRow = r; 
-                        int epCol = tc;
-
-                        bool isEnPassant = (p->getType() == Pawn && victim == nullptr && c != tc);
-                        if (isEnPassant) {
-                            enPassantVictim = board.at(epRow).at(epCol);
-                            board.at(epRow).at(epCol) = nullptr;
-                        }
-
-                        board.at(tr).at(tc) = p;
-                        board.at(r).at(c) = nullptr;
-                        p->setPosition(tr, tc);
-
-                        bool isPromotion = (p->getType() == Pawn && (tr == 0 || tr == numRows - 1));
-                        ChessPiece* promotedPawn = nullptr;
-                        if (isPromotion) {
-                            promotedPawn = p;
-                            board.at(tr).at(tc) = new QueenPiece(*this, p->getColor(), tr, tc);
-                        }
-
-                        bool isCastling = (p->getType() == King && std::abs(tc - c) == 2);
-                        ChessPiece* castleRook = nullptr;
-                        int rookStartCol = -1, rookEndCol = -1;
-                        if (isCastling) {
-                            rookStartCol = (tc > c) ? (numCols - 1) : 0;
-                            rookEndCol = (tc > c) ? (tc - 1) : (tc + 1);
-                            castleRook = board.at(r).at(rookStartCol);
-                            if (castleRook) {
-                                board.at(r).at(rookEndCol) = castleRook;
-                                board.at(r).at(rookStartCol) = nullptr;
-                                castleRook->setPosition(r, rookEndCol);
-                            }
-                        }
-
-                        // SCORE
-                        float currentScore = scoreBoard();
-                        if (currentScore > maxScore) maxScore = currentScore;
-
-                        // UNDO
-                        if (isCastling && castleRook) {
-                            castleRook->setPosition(r, rookStartCol);
-                            board.at(r).at(rookStartCol) = castleRook;
-                            board.at(r).at(rookEndCol) = nullptr;
-                        }
-                        if (isPromotion) {
-                            delete board.at(tr).at(tc);
-                            board.at(tr).at(tc) = promotedPawn;
-                        }
-
-                        p->setPosition(r, c);
-                        board.at(r).at(c) = p;
-                        board.at(tr).at(tc) = victim;
-
-                        if (isEnPassant && enPassantVictim) {
-                             board.at(epRow).at(epCol) = enPassantVictim;
-                        }
-                    }
-                }
-            }
-        }
+    TablebaseResult tbResult;
+
+    // Simulated captures drop list entries and put them back in place, so
+    // walk the list by index.
+    for (size_t i = 0; i < pieceSquares.size(); ++i) {
+        int from = pieceSquares[i];
+        ChessPiece* p = squares[from];
+        if (p->getColor() != turn) continue;
+        int r = rowOf(from), c = columnOf(from);
+
+        // The board is restored after every simulated move, so the
+        // candidate walk can carry on over it.
+        forEachCandidate(from, [&](int to) {
+            if (!isValidMove(r, c, rowOf(to), columnOf(to))) return;
+            moveFound = true;
+            float currentScore = scoreAfterMove(from, to, tbResult);
+            if (currentScore > maxScore) maxScore = currentScore;
+        });
     }
 
     if (!moveFound) return scoreBoard();
     return maxScore;
 }
 
+float ChessBoard::getHighestNextScoreParallel(ThreadPool &pool) {
+    // Root moves in the order getHighestNextScore visits them.
+    std::vector<std::pair<int, int>> moves;
+    for (int from : pieceSquares) {
+        if (squares[from]->getColor() != turn) continue;
+        int r = rowOf(from), c = columnOf(from);
+        forEachCandidate(from, [&](int to) {
+            if (isValidMove(r, c, rowOf(to), columnOf(to))) moves.emplace_back(from, to);
+        });
+    }
+    if (moves.empty()) return scoreBoard();
+
+    // A few tasks per thread leave room for stealing when some moves take
+    // longer to score than others. Each task plays its moves on a copy of
+    // the board, which has the same square numbering.
+    std::vector<float> scores(moves.size());
+    size_t numTasks = std::min(moves.size(), size_t(pool.getNumThreads()) * ParallelTasksPerThread);
+    pool.run(numTasks, [&](size_t task) {
+        std::unique_ptr<ChessBoard> copy = clone();
+        TablebaseResult tbResult;
+        for (size_t i = moves.size() * task / numTasks; i < moves.size() * (task + 1) / numTasks; ++i)
+            scores[i] = copy->scoreAfterMove(moves[i].first, moves[i].second, tbResult);
+    });
+
+    // Reduced in move order, so the result never depends on the schedule.
+    float maxScore = -100000.0f;
+    for (float score : scores)
+        if (score > maxScore) maxScore = score;
+    return maxScore;
+}
+
 std::ostringstream ChessBoard::displayBoard()
 {
     std::ostringstream outputString;
@@ -437,7 +1267,7 @@ std::ostringstream ChessBoard::displayBoard()
     for (int row = 0; row < numRows; row++){
         outputString << row << "|";
         for (int column = 0; column < numCols; column++){
-            ChessPiece *piece = board.at(row).at(column);
+            ChessPiece *piece = at(row, column);
             outputString << (piece == nullptr ? " " : piece->toString()) << " ";
         }
         outputString << "|" << std::endl;
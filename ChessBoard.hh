@@ -3,38 +3,185 @@
 
 #include "ChessPiece.hh"
 #include "KingPiece.hh"
+#include "Move.hh"
+#include <cstdint>
+#include <functional>
 #include <list>
+#include <memory>
 #include <vector>
 #include <sstream>
+#include <stdexcept>
 
 namespace Student
 {
+    class Tablebase;
+    class EvalCache;
+    class NeuralNetwork;
+    class NeuralAccumulator;
+    class SlidingAttacks;
+    class ThreadPool;
+    struct TablebaseResult;
+
     class ChessBoard
     {
     private:
         int numRows = 0;
         int numCols = 0;
         Color turn = White;
+        // Optional endgame tables consulted before evaluating; not owned.
+        Tablebase *tablebase = nullptr;
+        // Optional cache of scoreBoard results; not owned.
+        EvalCache *evalCache = nullptr;
+        // Optional network scoring positions instead of evaluateBoard; not owned.
+        NeuralNetwork *network = nullptr;
+        // The network's accumulators for this board, kept in step by makeMove.
+        std::unique_ptr<NeuralAccumulator> accumulator;
+        // Mixed into every hash key so boards of different sizes never collide.
+        uint64_t hashSeed = 0;
+        // Polled between pieces by the move generators and evaluateBoard; once
+        // it has returned true they give up early until the check is replaced.
+        std::function<bool()> interruptCheck;
+        bool interrupted = false;
+        bool pollInterrupt()
+        {
+            if (!interrupted && interruptCheck) interrupted = interruptCheck();
+            return interrupted;
+        }
         /**
          * @brief
-         * A 2D vector of pointers to ChessPiece objects.
-         * board.at(row) returns the entire row.
-         * board.at(row).at(col) returns a pointer to a ChessPiece object.
-         * *(board.at(row).at(col)) returns the ChessPiece object itself.
+         * The board as one contiguous array of pointers to ChessPiece objects,
+         * row by row, inside a border of OffBoard sentinels: two rows above and
+         * below and one column on either side ((numRows + 4) x (numCols + 2)).
+         * A column step past either edge wraps into a border column, so every
+         * king step, knight jump or ray step from a board square lands on the
+         * board or on a sentinel and never needs a bounds check.
+         * squares[getSquare(row, col)] is the piece at (row, col), or nullptr.
          */
-        std::vector<std::vector<ChessPiece *>> board;
+        std::vector<ChessPiece *> squares;
+        // Distance between vertically adjacent squares.
+        int stride = 0;
+        // Unchecked access to a board position.
+        ChessPiece *at(int r, int c) { return squares[getSquare(r, c)]; }
+
+        // Attack tables for boards of up to 64 squares, or nullptr.
+        const SlidingAttacks *sliding = nullptr;
+        // Occupied squares as bits row * numCols + column, kept only when
+        // sliding is set.
+        uint64_t occupancy = 0;
+        // The occupancy bit of each padded square, zero on the border; empty
+        // without tables.
+        std::vector<uint64_t> squareBits;
+        // The padded square of each occupancy bit.
+        int bitSquares[64];
+        // On boards too large for tables, the occupied squares of every row,
+        // column and diagonal as bit sets of lineWords words each, so the
+        // nearest piece along a line is found a word at a time rather than a
+        // square at a time. Empty, with lineWords 0, on boards so narrow
+        // that walking is quicker than keeping the sets up.
+        std::vector<uint64_t> lineBits;
+        int lineWords = 0;
+        // Where in lineBits the line of a kind (row, column, diagonal,
+        // antidiagonal) through a square starts. A square's place on its row
+        // is its column, on the other lines its row.
+        size_t lineStart(int kind, int row, int column)
+        {
+            int line = (kind == 0) ? row :
+                       (kind == 1) ? numRows + column :
+                       (kind == 2) ? numRows + 2 * numCols - 1 + row - column :
+                                     2 * (numRows + numCols) - 1 + row + column;
+            return size_t(line) * lineWords;
+        }
+        void updateLines(int square, bool occupied)
+        {
+            int row = rowOf(square), column = columnOf(square);
+            for (int kind = 0; kind < 4; ++kind) {
+                int place = (kind == 0) ? column : row;
+                uint64_t &word = lineBits[lineStart(kind, row, column) + (place >> 6)];
+                uint64_t bit = uint64_t(1) << (place & 63);
+                word = occupied ? (word | bit) : (word & ~bit);
+            }
+        }
+        // The nearest occupied square from a square in one of the directions
+        // {-stride, -1, 1, stride, -stride - 1, -stride + 1, stride - 1,
+        // stride + 1}, or 0, which is always OffBoard, if the line leaves
+        // the board first. Only when lineWords is set.
+        int nextPiece(int row, int column, int direction);
+        // Every write to squares goes through here to keep occupancy in step.
+        void put(int square, ChessPiece *p)
+        {
+            if (lineWords && (squares[square] != nullptr) != (p != nullptr)) updateLines(square, p != nullptr);
+            squares[square] = p;
+            if (sliding) occupancy = (occupancy & ~squareBits[square]) | (p ? squareBits[square] : 0);
+        }
+        int rowOf(int square) const { return square / stride - 2; }
+        int columnOf(int square) const { return square % stride - 1; }
+
+        // Squares holding a piece, in no particular order, so that whole-board
+        // scans cost the number of pieces rather than the board area.
+        std::vector<int> pieceSquares;
+        // Position of each occupied square's entry in pieceSquares. Sized like
+        // squares, so a board takes about 12 bytes per square whatever its
+        // piece count: 0.5 MB at 200x200, 3.2 MB at 500x500 and 13 MB at
+        // 1000x1000, of which lineBits is under 1%.
+        std::vector<int> pieceIndex;
+        void listPiece(int square);
+        // Drops a square's entry and returns where it was, for relistPiece.
+        int unlistPiece(int square);
+        // Puts back an entry dropped by unlistPiece; undoing drops in reverse
+        // order restores the list exactly.
+        void relistPiece(int square, int index);
+        // Moves a square's entry along with its piece.
+        void shiftPiece(int from, int to);
         bool isPseudoValidMove(int fromRow, int fromColumn, int toRow, int toColumn);
         // Stores the coordinates of the square "skipped" by a double-moving pawn.
         // Initialized to {-1, -1}.
         std::pair<int, int> enPassantTarget;
         bool isSquareUnderAttack(int row, int column, Color byColor);
+        // Plays out the captures on a square whose occupant is worth
+        // victimValue, side first, starting with the given piece or with the
+        // least valuable attacker if it is null; see exchangeValue.
+        int resolveExchange(int square, int victimValue, Color side, ChessPiece *first);
         bool wouldLeaveKingInCheck(int fromRow, int fromColumn, int toRow, int toColumn);
         std::pair<int,int> findKing(Color c);
         // In ChessBoard.hh
 
         // Helper to validate castling rules specifically
         bool isValidCastling(int fromRow, int fromColumn, int toRow, int toColumn);
-        int getPieceValue(Type t);
+        // Calls visit(toSquare) for every square the piece on a square might
+        // move to; a superset of its valid moves, to be filtered by isValidMove.
+        template <typename Visit>
+        void forEachCandidate(int square, Visit visit);
+        // Material and mobility score behind scoreBoard, without the cache.
+        float evaluateBoard();
+
+        // Valid moves of each colour in the current position, filled on
+        // demand by getLegalMoves and dropped whenever the position changes.
+        std::vector<Move> legalMoves[2];
+        bool legalMovesKnown[2] = {false, false};
+        // Appends the valid moves of one colour's pieces, in board order.
+        void addValidMoves(Color c, std::vector<Move> &moves);
+        const std::vector<Move> &legalMovesOf(Color c);
+        void invalidateLegalMoves() { legalMovesKnown[Black] = legalMovesKnown[White] = false; }
+        bool hasValidMove(Color c);
+
+        // Plies since the last capture or pawn move.
+        int halfmoveClock = 0;
+        // Hash keys of the positions before each movePiece since the last
+        // capture or pawn move, for spotting repetitions. Search moves made
+        // with makeMove are not recorded.
+        std::vector<uint64_t> positionHistory;
+        // Forgets the game so far after the position was edited directly.
+        void resetHistory();
+
+        // Queens kept per colour (at least one per pawn) so that simulated
+        // promotions never allocate.
+        std::vector<ChessPiece *> spareQueens[2];
+        ChessPiece *takeSpareQueen(Color c, int row, int column);
+        void returnSpareQueen(ChessPiece *queen);
+
+        // Plays a valid move of the side to move without handing over the
+        // turn, scores the result for getHighestNextScore and takes it back.
+        float scoreAfterMove(int from, int to, TablebaseResult &tbResult);
 
     public:
         /**
@@ -51,9 +198,25 @@ namespace Student
         ~ChessBoard();
         ChessBoard(const ChessBoard&) = delete;
         ChessBoard& operator=(const ChessBoard&) = delete;
+
+        /**
+         * @brief
+         * Creates an independent board holding the same position: pieces with
+         * their moved flags, turn and en passant target. The copy shares the
+         * attached tablebase and evaluation cache.
+         * @return
+         * The new board.
+         */
+        std::unique_ptr<ChessBoard> clone();
         // Getter for the en passant target
         std::pair<int, int> getEnPassantTarget() { return enPassantTarget; }
 
+        /**
+         * @return
+         * Colour of the side to move.
+         */
+        Color getTurn() { return turn; }
+
         /**
          * @return
          * Number of rows in chess board.
@@ -69,8 +232,66 @@ namespace Student
         /**
          * @return
          * Pointer to a piece.
+         * Throws std::out_of_range for positions off the board.
+         */
+        ChessPiece *getPiece(int r, int c)
+        {
+            if (r < 0 || r >= numRows || c < 0 || c >= numCols) throw std::out_of_range("ChessBoard::getPiece");
+            return squares[getSquare(r, c)];
+        }
+
+        // Marks the border squares around the board.
+        static ChessPiece *const OffBoard;
+
+        /**
+         * @return
+         * Index of a position in the padded square layout. Horizontal
+         * neighbours differ by 1 and vertical ones by getStride().
          */
-        ChessPiece *getPiece(int r, int c) { return board.at(r).at(c); }
+        int getSquare(int r, int c) const { return (r + 2) * stride + c + 1; }
+
+        /**
+         * @return
+         * Distance between vertically adjacent squares.
+         */
+        int getStride() const { return stride; }
+
+        /**
+         * @brief
+         * Checks that no piece stands strictly between two squares on the
+         * same row, column or diagonal. Uses attack tables on boards of up to
+         * 64 squares, the occupancy of each line on boards at least 48
+         * squares either way, and walks the squares otherwise.
+         * @return
+         * Returns true if the line between the squares is empty.
+         */
+        bool isLineClear(int fromRow, int fromColumn, int toRow, int toColumn);
+
+        /**
+         * @return
+         * The piece on a square of the padded layout: nullptr when empty,
+         * OffBoard on the border. Unchecked, for walking rays from a board square.
+         */
+        ChessPiece *pieceOn(int square) const { return squares[square]; }
+
+        /**
+         * @return
+         * The squares of the padded layout that hold a piece, in no
+         * particular order.
+         */
+        const std::vector<int> &getPieceSquares() const { return pieceSquares; }
+
+        /**
+         * @return
+         * Row of a board square of the padded layout.
+         */
+        int getRowOf(int square) const { return rowOf(square); }
+
+        /**
+         * @return
+         * Column of a board square of the padded layout.
+         */
+        int getColumnOf(int square) const { return columnOf(square); }
 
         /**
          * @brief
@@ -88,6 +309,16 @@ namespace Student
          */
         void createChessPiece(Color col, Type ty, int startRow, int startColumn);
 
+        /**
+         * @brief
+         * Frees the piece at a position, if any, and leaves the square empty.
+         * @param row
+         * Row of the piece to be removed.
+         * @param column
+         * Column of the piece to be removed.
+         */
+        void removeChessPiece(int row, int column);
+
         /**
          * @brief
          * Performs the move if the move is valid.
@@ -138,6 +369,179 @@ namespace Student
          */
         bool isPieceUnderThreat(int row, int column);
 
+        /**
+         * @brief
+         * Static exchange evaluation: plays out the captures on a square
+         * without touching the board, each side capturing with its least
+         * valuable attacker and sliders behind the capturing pieces (x-rays)
+         * joining in. Either side may stop when capturing no longer pays.
+         * Pins, en passant and promotions are not considered.
+         * @param row
+         * Row of the piece being checked.
+         * @param column
+         * Column of the piece being checked.
+         * @return
+         * Material the opponent of the piece wins by capturing it, in
+         * getPieceValue units: 0 if the square is empty or the piece is
+         * defended well enough.
+         */
+        int exchangeValue(int row, int column);
+
+        /**
+         * @return
+         * Material the side to move wins, or loses if negative, by playing
+         * a capture and then the best exchange on its destination. Must be
+         * called before the move is made.
+         */
+        int exchangeValue(const Move &capture);
+
+        /**
+         * @return
+         * Returns true if the king of the side to move is attacked.
+         */
+        bool isInCheck();
+
+        /**
+         * @brief
+         * Tells whether the game is over. Repetitions are checked first from
+         * the history of moves played with movePiece; for mate and stalemate
+         * the search for a move stops at the first valid one.
+         * @return
+         * Checkmate or Stalemate when the side to move has no valid move;
+         * ThreefoldRepetition when the position has occurred twice before
+         * with the same side to move, castling rights and en passant target;
+         * FiftyMoveRule after 100 plies without a capture or pawn move;
+         * otherwise InProgress.
+         */
+        GameStatus getGameStatus();
+
+        /**
+         * @return
+         * Plies played since the last capture or pawn move. Placing or
+         * removing pieces resets it.
+         */
+        int getHalfmoveClock() { return halfmoveClock; }
+
+        /**
+         * @brief
+         * Sets the state that does not show in the pieces, for positions put
+         * together piece by piece from storage. Call it after placing the
+         * pieces, which resets the clock. The repetition history stays empty.
+         * @param enPassantTarget
+         * The square skipped by a pawn's double step last move, or {-1, -1}.
+         */
+        void restoreState(Color turn, std::pair<int, int> enPassantTarget, int halfmoveClock);
+
+        /**
+         * @brief
+         * Lists every valid move of the side to move, including castling.
+         * @param moves
+         * Cleared, then filled with the moves. Reusing the same vector
+         * avoids allocating once it has grown large enough.
+         */
+        void generateLegalMoves(std::vector<Move> &moves);
+
+        /**
+         * @brief
+         * Lists where the piece at a position may move, as isValidMove would
+         * answer for every square. The moves of the whole position are worked
+         * out once and reused until a piece is moved, created or removed.
+         * @param row
+         * Row of the piece.
+         * @param column
+         * Column of the piece.
+         * @return
+         * Destinations as (row, column) pairs in board order; empty if the
+         * square is empty or off the board.
+         */
+        std::vector<std::pair<int, int>> getLegalMoves(int row, int column);
+
+        /**
+         * @return
+         * Every valid move of the side to move, as generateLegalMoves lists
+         * them. Reused until the position changes; the reference stays valid
+         * until then.
+         */
+        const std::vector<Move> &getAllLegalMoves();
+
+        /**
+         * @brief
+         * Lists the valid captures (en passant included) and promotions of
+         * the side to move, for quiescence search.
+         * @param moves
+         * Cleared, then filled with the moves.
+         */
+        void generateTacticalMoves(std::vector<Move> &moves);
+
+        /**
+         * @brief
+         * Lists the valid moves generateTacticalMoves leaves out: moves to
+         * empty squares other than en passant and promotions, and castling.
+         * Together the two give generateLegalMoves's moves.
+         * @param moves
+         * Cleared, then filled with the moves.
+         */
+        void generateQuietMoves(std::vector<Move> &moves);
+
+        /**
+         * @brief
+         * Plays a valid move and hands the turn over, like movePiece, but keeps
+         * captured pieces so unmakeMove can restore the position exactly.
+         * Used by searches to walk the game tree on a single board; does not
+         * allocate, promotions take one of the board's spare queens.
+         * @param move
+         * The move to play. Must be valid for the side to move.
+         * @param undo
+         * Filled with what unmakeMove needs.
+         */
+        void makeMove(const Move &move, MoveUndo &undo);
+
+        /**
+         * @brief
+         * Takes back a move played by makeMove. Moves must be taken back in
+         * reverse order.
+         */
+        void unmakeMove(const Move &move, const MoveUndo &undo);
+
+        /**
+         * @brief
+         * Passes the turn without moving, for null-move pruning. Clears the
+         * en passant target.
+         * @param undo
+         * Filled with what unmakeNullMove needs.
+         */
+        void makeNullMove(MoveUndo &undo);
+
+        /**
+         * @brief
+         * Takes back a pass played by makeNullMove.
+         */
+        void unmakeNullMove(const MoveUndo &undo);
+
+        /**
+         * @return
+         * Returns true if the colour has a piece other than pawns and kings,
+         * i.e. the position is unlikely to be a zugzwang for it.
+         */
+        bool hasNonPawnMaterial(Color c);
+
+        /**
+         * @brief
+         * Counts the leaf positions of the move tree, for testing move
+         * generation and measuring its speed.
+         * @param depth
+         * Number of plies to play out.
+         * @return
+         * Number of move sequences of that length from the position.
+         */
+        uint64_t perft(int depth);
+
+        /**
+         * @return
+         * Material value of a piece type, as used by scoreBoard.
+         */
+        static int getPieceValue(Type t);
+
         /**
          * @brief
          * Returns an output string stream displaying the layout of the board.
@@ -149,14 +553,95 @@ namespace Student
         std::ostringstream displayBoard();
         /**
          * @brief Computes the score of the board from the perspective of the current turn.
+         * Answered from the attached evaluation cache when it holds the position,
+         * or by the attached neural network if there is one.
          */
         float scoreBoard();
 
+        /**
+         * @return
+         * Hash of the position: pieces, side to move, castling rights and
+         * en passant target. Equal positions hash alike on every board of
+         * the same size, so results keyed by it can be shared between boards.
+         */
+        uint64_t getHashKey();
+
+        /**
+         * @brief
+         * Attaches a cache in front of scoreBoard. One cache may serve many boards.
+         * @param cache
+         * The cache to use, or nullptr to detach. Not owned.
+         */
+        void setEvalCache(EvalCache *cache) { evalCache = cache; }
+
+        /**
+         * @brief
+         * Lets a long-running caller such as a search cut work on a large
+         * board short. The check is called between pieces; once it returns
+         * true, generateLegalMoves, generateTacticalMoves, generateQuietMoves
+         * and scoreBoard return at once with partial results, which are not
+         * cached, until the check is replaced. Not copied by clone.
+         * @param check
+         * The check, or an empty function to stop polling.
+         */
+        void setInterruptCheck(std::function<bool()> check)
+        {
+            interruptCheck = std::move(check);
+            interrupted = false;
+        }
+
+        /**
+         * @return
+         * Returns true once the interrupt check has returned true.
+         */
+        bool isInterrupted() { return interrupted; }
+
+        /**
+         * @brief
+         * Lets a neural network score positions in place of scoreBoard's
+         * material and mobility formula, bypassing the evaluation cache. Its
+         * first layer is updated incrementally by makeMove and unmakeMove.
+         * One network may serve many boards.
+         * @param network
+         * A loaded network for this board size, or nullptr to detach. Not owned.
+         * @return
+         * Returns false, leaving the board as it was, if the network is not
+         * loaded or was made for another board size.
+         */
+        bool setNeuralNetwork(NeuralNetwork *network);
+
         /**
          * @brief Simulates all valid moves for the current player and returns the highest
          * resulting score (from the original player's perspective).
+         * Positions covered by the attached tablebase are scored from the table
+         * instead of by scoreBoard.
          */
         float getHighestNextScore();
+
+        /**
+         * @brief
+         * getHighestNextScore with the moves scored on a thread pool. Moves
+         * are split into a few tasks per thread, each playing its moves on a
+         * copy of the board, and the highest score is taken in move order,
+         * so the result is exactly that of getHighestNextScore.
+         * @param pool
+         * The threads to use. The board must not change until it returns.
+         */
+        float getHighestNextScoreParallel(ThreadPool &pool);
+
+        /**
+         * @brief
+         * Attaches endgame tables to be consulted before evaluating positions.
+         * @param tb
+         * Tables for this board's geometry, or nullptr to detach. Not owned.
+         */
+        void setTablebase(Tablebase *tb) { tablebase = tb; }
+
+        /**
+         * @return
+         * The attached endgame tables, or nullptr.
+         */
+        Tablebase *getTablebase() { return tablebase; }
     };
 }
 
@@ -101,6 +101,7 @@ namespace Student
 
     bool getHasMoved() { return hasMoved; }
     void markAsMoved() { hasMoved = true; }
+    void setHasMoved(bool moved) { hasMoved = moved; }
   };
 }
 
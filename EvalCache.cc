@@ -0,0 +1,57 @@
+#include "EvalCache.hh"
+#include "Stats.hh"
+#include <cstring>
+
+using Student::EvalCache;
+
+namespace
+{
+    // Marks a slot as written, so an empty slot never matches a key.
+    const uint64_t ValidBit = uint64_t(1) << 32;
+}
+
+EvalCache::EvalCache(size_t size)
+{
+    numEntries = 1;
+    while (numEntries * 2 <= size) numEntries *= 2;
+    entries.reset(new Entry[numEntries]);
+}
+
+bool EvalCache::probe(uint64_t key, float &score)
+{
+    Entry &e = entries[key & (numEntries - 1)];
+    uint64_t data = e.data.load(std::memory_order_relaxed);
+    uint64_t check = e.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || !(data & ValidBit)) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        STATS_COUNT(CacheMisses);
+        return false;
+    }
+
+    uint32_t bits = uint32_t(data);
+    std::memcpy(&score, &bits, sizeof(score));
+    hits.fetch_add(1, std::memory_order_relaxed);
+    STATS_COUNT(CacheHits);
+    return true;
+}
+
+void EvalCache::store(uint64_t key, float score)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &score, sizeof(bits));
+    uint64_t data = ValidBit | bits;
+
+    Entry &e = entries[key & (numEntries - 1)];
+    e.check.store(key ^ data, std::memory_order_relaxed);
+    e.data.store(data, std::memory_order_relaxed);
+}
+
+void EvalCache::clear()
+{
+    for (size_t i = 0; i < numEntries; ++i) {
+        entries[i].check.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+    hits.store(0, std::memory_order_relaxed);
+    misses.store(0, std::memory_order_relaxed);
+}
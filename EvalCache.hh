@@ -0,0 +1,90 @@
+#ifndef __EVALCACHE_H__
+#define __EVALCACHE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Student
+{
+    /**
+     * @brief
+     * Fixed-size cache of scoreBoard results keyed by position hash.
+     * Lookups and stores are lock-free, so one cache may be shared by boards
+     * on different threads. Each slot keeps the key XOR-ed with its data;
+     * a slot torn by a concurrent store fails that check and reads as a miss.
+     * Colliding positions simply overwrite each other.
+     */
+    class EvalCache
+    {
+    private:
+        struct Entry
+        {
+            std::atomic<uint64_t> check{0};
+            std::atomic<uint64_t> data{0};
+        };
+
+        std::unique_ptr<Entry[]> entries;
+        size_t numEntries = 0;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+
+    public:
+        /**
+         * @brief
+         * Allocates the cache.
+         * @param size
+         * Requested number of entries, rounded down to a power of two (at least 1).
+         */
+        explicit EvalCache(size_t size);
+
+        EvalCache(const EvalCache&) = delete;
+        EvalCache& operator=(const EvalCache&) = delete;
+
+        /**
+         * @brief
+         * Looks up a position and counts the hit or miss.
+         * @param key
+         * Hash of the position, as returned by ChessBoard::getHashKey.
+         * @param score
+         * Set to the cached score on a hit.
+         * @return
+         * Returns true on a hit.
+         */
+        bool probe(uint64_t key, float &score);
+
+        /**
+         * @brief
+         * Stores the score of a position, replacing whatever shared its slot.
+         */
+        void store(uint64_t key, float score);
+
+        /**
+         * @brief
+         * Empties every slot and resets the counters.
+         * Must not run concurrently with probe or store.
+         */
+        void clear();
+
+        /**
+         * @return
+         * Number of entries in the cache.
+         */
+        size_t getSize() { return numEntries; }
+
+        /**
+         * @return
+         * Number of probes answered from the cache.
+         */
+        uint64_t getHits() { return hits.load(std::memory_order_relaxed); }
+
+        /**
+         * @return
+         * Number of probes that missed.
+         */
+        uint64_t getMisses() { return misses.load(std::memory_order_relaxed); }
+    };
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "GameManager.hh"
+#include "ChessBoard.hh"
+#include <algorithm>
+#include <cstring>
+
+using Student::GameManager;
+using Student::ChessBoard;
+using Student::ChessPiece;
+using Student::Move;
+
+namespace
+{
+    // Reused for every game a thread touches; unpacking only replaces the
+    // pieces that differ, so consecutive moves in one game are cheap.
+    thread_local std::unique_ptr<ChessBoard> scratch;
+
+    int pieceCode(ChessPiece *p)
+    {
+        return p ? 1 + p->getColor() * 6 + p->getType() : 0;
+    }
+}
+
+GameManager::GameManager(size_t maxGames)
+  : capacity(std::min(maxGames, size_t(NoGame)))
+{
+    chunks.resize((capacity + ChunkSize - 1) / ChunkSize);
+}
+
+GameManager::Slot *GameManager::slotOf(GameId id)
+{
+    if (id >= numSlots.load(std::memory_order_acquire)) return nullptr;
+    return &chunks[id / ChunkSize][id % ChunkSize];
+}
+
+void GameManager::pack(ChessBoard &board, Slot &slot)
+{
+    int numRows = board.getNumRows(), numCols = board.getNumCols();
+    slot.numRows = uint8_t(numRows);
+    slot.numCols = uint8_t(numCols);
+    slot.turn = uint8_t(board.getTurn());
+    slot.enPassantRow = int8_t(board.getEnPassantTarget().first);
+    slot.enPassantColumn = int8_t(board.getEnPassantTarget().second);
+    slot.halfmoveClock = uint8_t(std::min(board.getHalfmoveClock(), 255));
+    std::memset(slot.pieces, 0, sizeof(slot.pieces));
+    std::memset(slot.moved, 0, sizeof(slot.moved));
+    for (int r = 0; r < numRows; ++r) {
+        for (int c = 0; c < numCols; ++c) {
+            ChessPiece *p = board.getPiece(r, c);
+            if (!p) continue;
+            int i = r * numCols + c;
+            slot.pieces[i / 2] |= uint8_t(pieceCode(p) << (4 * (i % 2)));
+            if (p->getHasMoved()) slot.moved[i / 8] |= uint8_t(1 << (i % 8));
+        }
+    }
+}
+
+void GameManager::unpack(const Slot &slot, ChessBoard &board)
+{
+    for (int r = 0; r < slot.numRows; ++r) {
+        for (int c = 0; c < slot.numCols; ++c) {
+            int i = r * slot.numCols + c;
+            int code = (slot.pieces[i / 2] >> (4 * (i % 2))) & 0xF;
+            ChessPiece *p = board.getPiece(r, c);
+            if (code == 0) {
+                if (p) board.removeChessPiece(r, c);
+                continue;
+            }
+            if (pieceCode(p) != code) board.createChessPiece(Color((code - 1) / 6), Type((code - 1) % 6), r, c);
+            board.getPiece(r, c)->setHasMoved((slot.moved[i / 8] >> (i % 8)) & 1);
+        }
+    }
+    board.restoreState(Color(slot.turn), {slot.enPassantRow, slot.enPassantColumn}, slot.halfmoveClock);
+}
+
+ChessBoard &GameManager::scratchBoard(const Slot &slot)
+{
+    if (!scratch || scratch->getNumRows() != slot.numRows || scratch->getNumCols() != slot.numCols)
+        scratch.reset(new ChessBoard(slot.numRows, slot.numCols));
+    unpack(slot, *scratch);
+    return *scratch;
+}
+
+GameManager::GameId GameManager::addGame(ChessBoard &board)
+{
+    if (board.getNumRows() < 1 || board.getNumCols() < 1 || board.getNumRows() * board.getNumCols() > MaxSquares)
+        return NoGame;
+
+    GameId id;
+    {
+        std::lock_guard<std::mutex> lock(allocationMutex);
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            size_t n = numSlots.load(std::memory_order_relaxed);
+            if (n >= capacity) return NoGame;
+            // Value-initialised, so every slot of a new chunk reads as free.
+            if (n % ChunkSize == 0) chunks[n / ChunkSize].reset(new Slot[ChunkSize]());
+            id = GameId(n);
+            numSlots.store(n + 1, std::memory_order_release);
+        }
+    }
+
+    Slot &slot = *slotOf(id);
+    {
+        std::lock_guard<std::mutex> lock(lockOf(id));
+        pack(board, slot);
+        slot.historySize = 0;
+        slot.status = uint8_t(board.getGameStatus());
+    }
+    numGames.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+bool GameManager::endGame(GameId id)
+{
+    Slot *slot = slotOf(id);
+    if (!slot) return false;
+    {
+        std::lock_guard<std::mutex> lock(lockOf(id));
+        if (slot->numRows == 0) return false;
+        slot->numRows = 0;
+    }
+    std::lock_guard<std::mutex> lock(allocationMutex);
+    freeIds.push_back(id);
+    numGames.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool GameManager::applyMove(GameId id, const Move &move)
+{
+    Slot *slot = slotOf(id);
+    if (!slot) return false;
+    std::lock_guard<std::mutex> lock(lockOf(id));
+    if (slot->numRows == 0 || slot->status != InProgress) return false;
+
+    ChessBoard &board = scratchBoard(*slot);
+    uint32_t previous = uint32_t(board.getHashKey() >> 32);
+    if (!board.movePiece(move.fromRow, move.fromColumn, move.toRow, move.toColumn)) return false;
+    pack(board, *slot);
+
+    // Positions before a capture or pawn move can never come back.
+    if (slot->halfmoveClock == 0) {
+        slot->historySize = 0;
+    } else {
+        if (slot->historySize == MaxHistory) {
+            std::memmove(slot->history, slot->history + 1, (MaxHistory - 1) * sizeof(uint32_t));
+            --slot->historySize;
+        }
+        slot->history[slot->historySize++] = previous;
+    }
+
+    // The same test as ChessBoard::getGameStatus on the stored history; the
+    // scratch board has none of its own.
+    uint32_t current = uint32_t(board.getHashKey() >> 32);
+    int repeats = 0;
+    if (slot->historySize >= 4) {
+        for (int i = 0; i < slot->historySize; ++i)
+            if (slot->history[i] == current) ++repeats;
+    }
+    slot->status = uint8_t(repeats >= 2 ? ThreefoldRepetition : board.getGameStatus());
+    return true;
+}
+
+GameStatus GameManager::getStatus(GameId id)
+{
+    Slot *slot = slotOf(id);
+    if (!slot) return InProgress;
+    std::lock_guard<std::mutex> lock(lockOf(id));
+    return slot->numRows ? GameStatus(slot->status) : InProgress;
+}
+
+bool GameManager::getLegalMoves(GameId id, std::vector<Move> &moves)
+{
+    moves.clear();
+    Slot *slot = slotOf(id);
+    if (!slot) return false;
+    std::lock_guard<std::mutex> lock(lockOf(id));
+    if (slot->numRows == 0) return false;
+    scratchBoard(*slot).generateLegalMoves(moves);
+    return true;
+}
+
+std::unique_ptr<ChessBoard> GameManager::getBoard(GameId id)
+{
+    Slot *slot = slotOf(id);
+    if (!slot) return nullptr;
+    std::lock_guard<std::mutex> lock(lockOf(id));
+    if (slot->numRows == 0) return nullptr;
+    std::unique_ptr<ChessBoard> board(new ChessBoard(slot->numRows, slot->numCols));
+    unpack(*slot, *board);
+    return board;
+}
+
+size_t GameManager::getMemoryUsage()
+{
+    size_t slots = numSlots.load(std::memory_order_acquire);
+    size_t bytes = sizeof(*this) + chunks.capacity() * sizeof(chunks[0]);
+    bytes += (slots + ChunkSize - 1) / ChunkSize * ChunkSize * sizeof(Slot);
+    std::lock_guard<std::mutex> lock(allocationMutex);
+    return bytes + freeIds.capacity() * sizeof(GameId);
+}
+
+double GameManager::getMemoryPerGame()
+{
+    size_t games = getNumGames();
+    return games ? double(getMemoryUsage()) / double(games) : double(sizeof(Slot));
+}
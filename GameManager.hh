@@ -0,0 +1,177 @@
+#ifndef __GAMEMANAGER_H__
+#define __GAMEMANAGER_H__
+
+#include "Chess.h"
+#include "Move.hh"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Hosts many games at once without a ChessBoard per game. Each game is
+     * packed into a fixed-size slot of a few hundred bytes: four bits per
+     * square, a bit per square for pieces that have moved, the state a
+     * board keeps besides its pieces and short hashes of the positions
+     * since the last capture or pawn move, for spotting repetitions.
+     * Moves are checked and played on a scratch board per thread, which is
+     * unpacked from the slot, so the rules are exactly ChessBoard's.
+     *
+     * Slots are allocated in chunks as games are added and reused once a
+     * game is ended. Calls on different games may run concurrently; calls
+     * on the same game are serialised by one of a fixed set of locks that
+     * games share by ID.
+     */
+    class GameManager
+    {
+    public:
+        typedef uint32_t GameId;
+        // Returned when a game cannot be added.
+        static const GameId NoGame = UINT32_MAX;
+        // Largest board a slot holds, in squares.
+        static const int MaxSquares = 128;
+        // Positions kept for repetitions; the fifty-move rule ends the game
+        // before more are needed.
+        static const int MaxHistory = 100;
+
+    private:
+        struct Slot
+        {
+            // 0 for a free slot.
+            uint8_t numRows;
+            uint8_t numCols;
+            uint8_t turn;
+            uint8_t status;
+            int8_t enPassantRow;
+            int8_t enPassantColumn;
+            uint8_t halfmoveClock;
+            uint8_t historySize;
+            // Two squares per byte, 0 when empty, else 1 + colour * 6 + type.
+            uint8_t pieces[MaxSquares / 2];
+            uint8_t moved[MaxSquares / 8];
+            // Upper halves of the hash keys of earlier positions, oldest first.
+            uint32_t history[MaxHistory];
+        };
+
+        // Slots per chunk.
+        static const size_t ChunkSize = 4096;
+        static const size_t NumLocks = 1024;
+
+        size_t capacity;
+        // Allocated up front and filled as games are added, so looking up a
+        // game never races with adding one.
+        std::vector<std::unique_ptr<Slot[]>> chunks;
+        std::mutex locks[NumLocks];
+        // Guards adding and ending games.
+        std::mutex allocationMutex;
+        std::vector<GameId> freeIds;
+        // IDs below this have a slot.
+        std::atomic<size_t> numSlots{0};
+        std::atomic<size_t> numGames{0};
+
+        Slot *slotOf(GameId id);
+        std::mutex &lockOf(GameId id) { return locks[id % NumLocks]; }
+        static void pack(ChessBoard &board, Slot &slot);
+        static void unpack(const Slot &slot, ChessBoard &board);
+        // The board of the slot on this thread's scratch board.
+        static ChessBoard &scratchBoard(const Slot &slot);
+
+    public:
+        /**
+         * @brief
+         * Creates an empty manager.
+         * @param maxGames
+         * Most games held at once.
+         */
+        explicit GameManager(size_t maxGames = size_t(1) << 20);
+
+        GameManager(const GameManager&) = delete;
+        GameManager& operator=(const GameManager&) = delete;
+
+        /**
+         * @brief
+         * Adds a game starting from a board's position: its pieces with
+         * their moved flags, turn, en passant target and halfmove clock.
+         * Repetitions count from this position on.
+         * @return
+         * The new game's ID, or NoGame if the manager is full or the board
+         * has more than MaxSquares squares.
+         */
+        GameId addGame(ChessBoard &board);
+
+        /**
+         * @brief
+         * Ends a game and frees its slot; its ID may be handed out again.
+         * @return
+         * Returns false if there is no such game.
+         */
+        bool endGame(GameId id);
+
+        /**
+         * @brief
+         * Plays a move in a game if it is valid for the side to move and
+         * the game is not over, as ChessBoard::movePiece does.
+         * @return
+         * Returns true if the move was played.
+         */
+        bool applyMove(GameId id, const Move &move);
+
+        /**
+         * @return
+         * The state of a game after its last move, as
+         * ChessBoard::getGameStatus reports it; InProgress if there is no
+         * such game.
+         */
+        GameStatus getStatus(GameId id);
+
+        /**
+         * @brief
+         * Lists the valid moves of the side to move in a game.
+         * @return
+         * Returns false if there is no such game.
+         */
+        bool getLegalMoves(GameId id, std::vector<Move> &moves);
+
+        /**
+         * @return
+         * A board holding a game's position, or nullptr if there is no such
+         * game.
+         */
+        std::unique_ptr<ChessBoard> getBoard(GameId id);
+
+        /**
+         * @return
+         * Number of games being hosted.
+         */
+        size_t getNumGames() { return numGames.load(std::memory_order_relaxed); }
+
+        /**
+         * @return
+         * Bytes held by the manager: slots allocated so far, locks and
+         * bookkeeping. Scratch boards, one per thread, are not counted.
+         */
+        size_t getMemoryUsage();
+
+        /**
+         * @return
+         * getMemoryUsage per game being hosted, or the size of one slot
+         * while there are none.
+         */
+        double getMemoryPerGame();
+
+        /**
+         * @return
+         * Size of one game's slot in bytes.
+         */
+        static size_t getSlotSize() { return sizeof(Slot); }
+    };
+}
+
+#endif
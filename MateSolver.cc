@@ -0,0 +1,258 @@
+#include "MateSolver.hh"
+#include "ChessBoard.hh"
+#include <algorithm>
+#include <chrono>
+
+using Student::MateSolver;
+using Student::MateResult;
+using Student::ChessBoard;
+using Student::Move;
+using Student::MoveUndo;
+
+namespace
+{
+    // A proof or disproof number that can no longer fall: the position is
+    // decided. Sums of finite numbers stop just below it.
+    const uint32_t Infinity = UINT32_MAX;
+    // Spreads the plies left over the keys, so a position to be mated in
+    // fewer moves is a different table entry.
+    const uint64_t RemainingMix = 0x9E3779B97F4A7C15ULL;
+}
+
+MateSolver::MateSolver(ChessBoard &b, size_t tableBytes)
+  : board(b)
+{
+    numEntries = 2;
+    while (numEntries * 2 * sizeof(Entry) <= tableBytes) numEntries *= 2;
+    table.reset(new Entry[numEntries]);
+}
+
+void MateSolver::clearTable()
+{
+    std::fill(table.get(), table.get() + numEntries, Entry());
+}
+
+uint64_t MateSolver::keyOf(int remaining)
+{
+    return board.getHashKey() ^ (uint64_t(remaining) * RemainingMix);
+}
+
+bool MateSolver::lookup(uint64_t key, Entry &entry)
+{
+    Entry *bucket = &table[(key & (numEntries / 2 - 1)) * 2];
+    for (int i = 0; i < 2; ++i) {
+        if (bucket[i].work && bucket[i].key == key) {
+            entry = bucket[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+void MateSolver::store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work)
+{
+    // The position's own entry if it has one, else whichever of the two
+    // took less work to find.
+    Entry *bucket = &table[(key & (numEntries / 2 - 1)) * 2];
+    Entry *slot = (bucket[0].work <= bucket[1].work) ? &bucket[0] : &bucket[1];
+    for (int i = 0; i < 2; ++i)
+        if (bucket[i].work && bucket[i].key == key) slot = &bucket[i];
+    slot->key = key;
+    slot->phi = phi;
+    slot->delta = delta;
+    slot->work = uint32_t(std::min<uint64_t>(std::max<uint64_t>(work, 1), UINT32_MAX));
+}
+
+MateResult MateSolver::solve(int maxMoves)
+{
+    MateResult result;
+    auto begin = std::chrono::steady_clock::now();
+    nodes = 0;
+    aborted = false;
+    if (childStack.size() < size_t(2 * std::max(maxMoves, 0) + 1)) childStack.resize(2 * std::max(maxMoves, 0) + 1);
+
+    result.outcome = MateResult::NoMate;
+    for (int n = 1; n <= maxMoves; ++n) {
+        int remaining = 2 * n - 1;
+        uint32_t phi = 1, delta = 1;
+        search(remaining, 0, keyOf(remaining), Infinity, Infinity, phi, delta);
+        result.moves = n;
+        if (aborted) {
+            result.outcome = MateResult::Unknown;
+            break;
+        }
+        if (phi == 0) {
+            // Replaying the proof may need positions the table lost; that
+            // work is not held to the node limit.
+            uint64_t limit = nodeLimit;
+            nodeLimit = 0;
+            extractLine(remaining, result.line);
+            nodeLimit = limit;
+            result.outcome = MateResult::Mate;
+            break;
+        }
+    }
+
+    result.nodes = nodes;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.nodesPerSecond = result.seconds > 0.0 ? double(nodes) / result.seconds : 0.0;
+    return result;
+}
+
+void MateSolver::search(int remaining, int ply, uint64_t key, uint32_t thPhi, uint32_t thDelta, uint32_t &phi,
+                        uint32_t &delta)
+{
+    uint64_t firstNode = ++nodes;
+    if (nodeLimit && nodes > nodeLimit) {
+        aborted = true;
+        return;
+    }
+
+    // The attacker's moves are used up: only a mate on the board counts,
+    // and a defender not in check cannot be mated.
+    if (remaining == 0) {
+        bool mated = false;
+        if (board.isInCheck()) {
+            board.generateLegalMoves(moves);
+            mated = moves.empty();
+        }
+        phi = mated ? Infinity : 0;
+        delta = mated ? 0 : Infinity;
+        store(key, phi, delta, 1);
+        return;
+    }
+
+    bool attacker = (remaining % 2 == 1);
+    board.generateLegalMoves(moves);
+    if (moves.empty()) {
+        // Mate or stalemate fails the side to move, but for a stalemated
+        // defender, who escapes.
+        bool failed = attacker || board.isInCheck();
+        phi = failed ? Infinity : 0;
+        delta = failed ? 0 : Infinity;
+        store(key, phi, delta, 1);
+        return;
+    }
+
+    std::vector<Child> &children = childStack[ply];
+    children.clear();
+    for (const Move &m : moves) {
+        MoveUndo undo;
+        board.makeMove(m, undo);
+        Child child;
+        child.move = m;
+        child.key = keyOf(remaining - 1);
+        Entry entry;
+        if (lookup(child.key, entry)) {
+            child.phi = entry.phi;
+            child.delta = entry.delta;
+        } else if (remaining == 1 && !board.isInCheck()) {
+            // A last move that does not give check cannot mate.
+            child.phi = 0;
+            child.delta = Infinity;
+        } else {
+            child.phi = 1;
+            child.delta = 1;
+        }
+        board.unmakeMove(m, undo);
+        children.push_back(child);
+    }
+
+    for (;;) {
+        // The side to move needs one child that fails for the opponent and
+        // has to rule out all of them to fail itself.
+        size_t best = 0;
+        uint32_t secondDelta = Infinity;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < children.size(); ++i) {
+            const Child &c = children[i];
+            sum = (c.phi == Infinity || sum == Infinity) ? Infinity : std::min<uint64_t>(sum + c.phi, Infinity - 1);
+            if (c.delta < children[best].delta) {
+                secondDelta = children[best].delta;
+                best = i;
+            } else if (i != best && c.delta < secondDelta) {
+                secondDelta = c.delta;
+            }
+        }
+        phi = children[best].delta;
+        delta = uint32_t(sum);
+        if (phi >= thPhi || delta >= thDelta) break;
+
+        // Search the most promising child until it stops being the most
+        // promising (delta past the runner-up's, with a little slack so
+        // the search does not flip between two close children) or the
+        // budget runs out.
+        Child &c = children[best];
+        uint32_t childThPhi = uint32_t(std::min<uint64_t>(uint64_t(thDelta) - delta + c.phi, Infinity));
+        uint64_t slack = (secondDelta == Infinity) ? Infinity : std::max<uint64_t>(secondDelta + 1, secondDelta + secondDelta / 4);
+        uint32_t childThDelta = uint32_t(std::min<uint64_t>(thPhi, slack));
+
+        MoveUndo undo;
+        board.makeMove(c.move, undo);
+        search(remaining - 1, ply + 1, c.key, childThPhi, childThDelta, c.phi, c.delta);
+        board.unmakeMove(c.move, undo);
+        if (aborted) return;
+    }
+    store(key, phi, delta, nodes - firstNode + 1);
+}
+
+void MateSolver::solveChild(int remaining, int ply, uint64_t key, uint32_t &phi, uint32_t &delta, uint32_t &work)
+{
+    Entry entry;
+    if (!lookup(key, entry) || (entry.phi != 0 && entry.delta != 0)) {
+        uint64_t firstNode = nodes;
+        phi = delta = 1;
+        search(remaining, ply, key, Infinity, Infinity, phi, delta);
+        entry.phi = phi;
+        entry.delta = delta;
+        entry.work = uint32_t(std::min<uint64_t>(nodes - firstNode, UINT32_MAX));
+    }
+    phi = entry.phi;
+    delta = entry.delta;
+    work = entry.work;
+}
+
+void MateSolver::extractLine(int remaining, std::vector<Move> &line)
+{
+    std::vector<MoveUndo> undos;
+    std::vector<Move> candidates;
+    while (remaining > 0) {
+        bool attacker = (remaining % 2 == 1);
+        board.generateLegalMoves(candidates);
+        if (candidates.empty()) break;
+
+        // The attacker plays a move that mates soonest, the defender the
+        // reply that puts the mate off longest, so the line is as long as
+        // the mate. Shorter mates are tried first, as solve does.
+        Move chosen;
+        int chosenMoves = 0;
+        uint32_t chosenWork = 0;
+        for (const Move &m : candidates) {
+            MoveUndo undo;
+            board.makeMove(m, undo);
+            int limit = attacker ? (chosen.isValid() ? chosenMoves - 1 : (remaining + 1) / 2) : remaining / 2;
+            for (int n = 1; n <= limit; ++n) {
+                uint32_t phi, delta, work;
+                int left = attacker ? 2 * n - 2 : 2 * n - 1;
+                solveChild(left, 0, keyOf(left), phi, delta, work);
+                // A proof for the attacker shows as delta at a defender's
+                // position and as phi at the attacker's.
+                if ((attacker ? delta : phi) != 0) continue;
+                if (attacker || n > chosenMoves || (n == chosenMoves && work > chosenWork)) {
+                    chosen = m;
+                    chosenMoves = n;
+                    chosenWork = work;
+                }
+                break;
+            }
+            board.unmakeMove(m, undo);
+        }
+        if (!chosen.isValid()) break;
+
+        line.push_back(chosen);
+        undos.emplace_back();
+        board.makeMove(chosen, undos.back());
+        remaining = attacker ? 2 * chosenMoves - 2 : 2 * chosenMoves - 1;
+    }
+    for (size_t i = line.size(); i-- > 0;) board.unmakeMove(line[i], undos[i]);
+}
@@ -0,0 +1,144 @@
+#ifndef __MATESOLVER_H__
+#define __MATESOLVER_H__
+
+#include "Move.hh"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Outcome of a mate search.
+     */
+    struct MateResult
+    {
+        enum Outcome
+        {
+            // The side to move mates in `moves` moves at most.
+            Mate,
+            // No mate in up to `moves` moves, whatever the defence.
+            NoMate,
+            // The node limit was reached first; mates shorter than `moves`
+            // were ruled out.
+            Unknown,
+        };
+        Outcome outcome = Unknown;
+        int moves = 0;
+        // For a mate, the moves of both sides in turn, ending in checkmate.
+        std::vector<Move> line;
+        uint64_t nodes = 0;
+        double seconds = 0.0;
+        double nodesPerSecond = 0.0;
+    };
+
+    /**
+     * @brief
+     * Proves or refutes forced mates with depth-first proof-number search
+     * (df-pn). Rather than scoring positions it counts how many positions
+     * still have to be shown mated (the proof number) or escaping (the
+     * disproof number) and always expands where that count is smallest, so
+     * narrow forcing lines are followed deep early. Mates of 1, 2, ... moves
+     * are tried in turn, each reusing the table of the shorter ones, so the
+     * first mate found is a shortest one.
+     * Proof and disproof numbers are kept in a fixed-size table; positions
+     * pushed out of it are searched again when needed, so a small table
+     * costs time, not correctness. Draws by repetition or the fifty-move
+     * rule are not considered. The board is used with makeMove/unmakeMove
+     * and is left unchanged.
+     */
+    class MateSolver
+    {
+    private:
+        struct Entry
+        {
+            uint64_t key = 0;
+            // Numbers of the side to move: the proof number if it is the
+            // attacker, the disproof number if it is the defender, and delta
+            // the other one.
+            uint32_t phi = 0;
+            uint32_t delta = 0;
+            // Nodes spent on the position; 0 marks an empty entry.
+            uint32_t work = 0;
+        };
+
+        struct Child
+        {
+            Move move;
+            uint64_t key;
+            uint32_t phi;
+            uint32_t delta;
+        };
+
+        ChessBoard &board;
+        std::unique_ptr<Entry[]> table;
+        // A power of two, two entries per bucket.
+        size_t numEntries = 0;
+        // Moves of every node on the current path, reused across nodes.
+        std::vector<std::vector<Child>> childStack;
+        std::vector<Move> moves;
+        uint64_t nodes = 0;
+        uint64_t nodeLimit = 0;
+        bool aborted = false;
+
+        // Key of a position with a number of plies left to mate in.
+        uint64_t keyOf(int remaining);
+        bool lookup(uint64_t key, Entry &entry);
+        void store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work);
+        // Searches the position until phi reaches thPhi or delta reaches
+        // thDelta, then returns both and stores them in the table.
+        void search(int remaining, int ply, uint64_t key, uint32_t thPhi, uint32_t thDelta, uint32_t &phi,
+                    uint32_t &delta);
+        // Finds the numbers of a child from the table, or searches it to the end.
+        void solveChild(int remaining, int ply, uint64_t key, uint32_t &phi, uint32_t &delta, uint32_t &work);
+        void extractLine(int remaining, std::vector<Move> &line);
+
+    public:
+        /**
+         * @brief
+         * Creates a solver for the position on a board.
+         * @param board
+         * The board to search; it must outlive the solver and not change
+         * while a search runs.
+         * @param tableBytes
+         * Memory for proof and disproof numbers.
+         */
+        MateSolver(ChessBoard &board, size_t tableBytes = size_t(64) << 20);
+
+        MateSolver(const MateSolver&) = delete;
+        MateSolver& operator=(const MateSolver&) = delete;
+
+        /**
+         * @brief
+         * Looks for a mate by the side to move in at most maxMoves of its
+         * moves. The table is kept between calls, so solving positions of
+         * the same game one after another reuses work.
+         */
+        MateResult solve(int maxMoves);
+
+        /**
+         * @brief
+         * Limits every call to solve to a number of nodes, or 0 for no
+         * limit (the default).
+         */
+        void setNodeLimit(uint64_t limit) { nodeLimit = limit; }
+
+        /**
+         * @brief
+         * Empties the table, e.g. before solving an unrelated position.
+         */
+        void clearTable();
+
+        /**
+         * @return
+         * Number of positions the table holds at most.
+         */
+        size_t getTableEntries() { return numEntries; }
+    };
+}
+
+#endif
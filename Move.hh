@@ -0,0 +1,64 @@
+#ifndef __MOVE_H__
+#define __MOVE_H__
+
+#include <utility>
+
+namespace Student
+{
+    class ChessPiece;
+
+    /**
+     * @brief
+     * A move from one square to another. Castling is the king's two-square
+     * move and promotion is implied by a pawn reaching the last row.
+     */
+    struct Move
+    {
+        int fromRow = -1;
+        int fromColumn = -1;
+        int toRow = -1;
+        int toColumn = -1;
+
+        Move() {}
+        Move(int fr, int fc, int tr, int tc) : fromRow(fr), fromColumn(fc), toRow(tr), toColumn(tc) {}
+
+        bool operator==(const Move &other) const
+        {
+            return fromRow == other.fromRow && fromColumn == other.fromColumn &&
+                   toRow == other.toRow && toColumn == other.toColumn;
+        }
+        bool operator!=(const Move &other) const { return !(*this == other); }
+
+        /**
+         * @return
+         * Returns false for a default-constructed move.
+         */
+        bool isValid() const { return fromRow >= 0; }
+    };
+
+    /**
+     * @brief
+     * Everything ChessBoard::makeMove changes that unmakeMove needs to put back.
+     */
+    struct MoveUndo
+    {
+        // Captured piece and the square it stood on (differs from the
+        // destination for en passant).
+        ChessPiece *captured = nullptr;
+        int capturedRow = -1;
+        int capturedColumn = -1;
+        // Where the captured piece sat in the board's piece list.
+        int capturedIndex = -1;
+        // The pawn replaced by a queen on promotion.
+        ChessPiece *promotedPawn = nullptr;
+        ChessPiece *castleRook = nullptr;
+        int rookFromColumn = -1;
+        int rookToColumn = -1;
+        bool rookHadMoved = false;
+        bool moverHadMoved = false;
+        std::pair<int, int> enPassantTarget;
+        int halfmoveClock = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "MoveOrdering.hh"
+#include "ChessBoard.hh"
+#include <utility>
+
+using Student::MoveOrderer;
+using Student::ChessBoard;
+using Student::ChessPiece;
+using Student::Move;
+
+namespace
+{
+    // Score bands; history scores stay below KillerScore.
+    const int HashMoveScore = 4000000;
+    const int TacticalScore = 2000000;
+    const int KillerScore = 1000000;
+    const int HistoryLimit = 500000;
+}
+
+MoveOrderer::MoveOrderer(int numRow, int numCol)
+{
+    numRows = numRow;
+    numCols = numCol;
+    killers = std::vector<Move>(MaxPly * 2);
+    history = std::vector<int>(2 * 6 * numRows * numCols, 0);
+}
+
+int MoveOrderer::historyIndex(Color c, Type t, int toRow, int toColumn)
+{
+    return (c * 6 + t) * numRows * numCols + toRow * numCols + toColumn;
+}
+
+bool MoveOrderer::isTactical(ChessBoard &board, const Move &move)
+{
+    ChessPiece *piece = board.getPiece(move.fromRow, move.fromColumn);
+    if (board.getPiece(move.toRow, move.toColumn) != nullptr) return true;
+    if (piece->getType() != Pawn) return false;
+    // En passant, or reaching the last row.
+    return move.fromColumn != move.toColumn || move.toRow == 0 || move.toRow == board.getNumRows() - 1;
+}
+
+int MoveOrderer::scoreTactical(ChessBoard &board, const Move &move)
+{
+    ChessPiece *attacker = board.getPiece(move.fromRow, move.fromColumn);
+    ChessPiece *victim = board.getPiece(move.toRow, move.toColumn);
+    // MVV-LVA; en passant takes a pawn and promotions count the new queen.
+    int gain = victim ? board.getPieceValue(victim->getType()) : (move.fromColumn != move.toColumn ? board.getPieceValue(Pawn) : 0);
+    if (attacker->getType() == Pawn && (move.toRow == 0 || move.toRow == board.getNumRows() - 1))
+        gain += board.getPieceValue(Queen);
+    return TacticalScore + gain * 1000 - board.getPieceValue(attacker->getType());
+}
+
+int MoveOrderer::scoreQuiet(ChessBoard &board, const Move &move)
+{
+    ChessPiece *piece = board.getPiece(move.fromRow, move.fromColumn);
+    return history[historyIndex(piece->getColor(), piece->getType(), move.toRow, move.toColumn)];
+}
+
+void MoveOrderer::scoreMoves(ChessBoard &board, const std::vector<Move> &moves, std::vector<int> &scores,
+                             int ply, const Move &hashMove)
+{
+    scores.resize(moves.size());
+    const Move *plyKillers = getKillers(ply);
+
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const Move &m = moves[i];
+        if (m == hashMove) {
+            scores[i] = HashMoveScore;
+        } else if (isTactical(board, m)) {
+            scores[i] = scoreTactical(board, m);
+        } else if (plyKillers && m == plyKillers[0]) {
+            scores[i] = KillerScore + 1;
+        } else if (plyKillers && m == plyKillers[1]) {
+            scores[i] = KillerScore;
+        } else {
+            scores[i] = scoreQuiet(board, m);
+        }
+    }
+}
+
+void MoveOrderer::pickNext(std::vector<Move> &moves, std::vector<int> &scores, size_t index)
+{
+    size_t best = index;
+    for (size_t i = index + 1; i < moves.size(); ++i)
+        if (scores[i] > scores[best]) best = i;
+    if (best != index) {
+        std::swap(moves[best], moves[index]);
+        std::swap(scores[best], scores[index]);
+    }
+}
+
+void MoveOrderer::recordCutoff(ChessBoard &board, const Move &move, int ply, int depth, size_t moveIndex, bool quiet)
+{
+    ++cutoffs;
+    if (moveIndex == 0) ++firstMoveCutoffs;
+    if (!quiet) return;
+
+    if (ply < MaxPly && killers[ply * 2] != move) {
+        killers[ply * 2 + 1] = killers[ply * 2];
+        killers[ply * 2] = move;
+    }
+
+    ChessPiece *piece = board.getPiece(move.fromRow, move.fromColumn);
+    int &h = history[historyIndex(piece->getColor(), piece->getType(), move.toRow, move.toColumn)];
+    h += depth * depth;
+    // Age the whole table rather than let one entry reach the killer band.
+    if (h >= HistoryLimit) {
+        for (int &entry : history) entry /= 2;
+    }
+}
+
+void MoveOrderer::clear()
+{
+    killers.assign(killers.size(), Move());
+    history.assign(history.size(), 0);
+    cutoffs = 0;
+    firstMoveCutoffs = 0;
+}
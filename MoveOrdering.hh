@@ -0,0 +1,137 @@
+#ifndef __MOVEORDERING_H__
+#define __MOVEORDERING_H__
+
+#include "Chess.h"
+#include "Move.hh"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Scores moves so a search tries the likeliest cutoff first:
+     * the hash move, then captures and promotions ordered most valuable
+     * victim / least valuable attacker, then killer moves of the ply, then
+     * the remaining quiet moves by history.
+     * Killers and history learn from the cutoffs reported by the search.
+     */
+    class MoveOrderer
+    {
+    private:
+        int numRows = 0;
+        int numCols = 0;
+        // Two killer moves per ply.
+        std::vector<Move> killers;
+        // History scores indexed by (colour, piece type, destination square).
+        std::vector<int> history;
+        uint64_t cutoffs = 0;
+        uint64_t firstMoveCutoffs = 0;
+
+        int historyIndex(Color c, Type t, int toRow, int toColumn);
+
+    public:
+        static const int MaxPly = 64;
+
+        /**
+         * @brief
+         * Creates an orderer with history tables sized for the board.
+         * @param numRow
+         * Number of rows of the chess board.
+         * @param numCol
+         * Number of columns of the chess board.
+         */
+        MoveOrderer(int numRow, int numCol);
+
+        /**
+         * @return
+         * Returns true if the move captures (en passant included) or promotes.
+         * Must be called before the move is made.
+         */
+        static bool isTactical(ChessBoard &board, const Move &move);
+
+        /**
+         * @return
+         * Ordering score of a capture or promotion: most valuable victim
+         * first, then least valuable attacker. Above every quiet move's score.
+         */
+        static int scoreTactical(ChessBoard &board, const Move &move);
+
+        /**
+         * @return
+         * Ordering score of a quiet move, from its history.
+         */
+        int scoreQuiet(ChessBoard &board, const Move &move);
+
+        /**
+         * @return
+         * The two killer moves of a ply, or nullptr past MaxPly. Entries may
+         * be invalid moves or moves that are not legal in the position.
+         */
+        const Move *getKillers(int ply) { return (ply < MaxPly) ? &killers[ply * 2] : nullptr; }
+
+        /**
+         * @brief
+         * Computes an ordering score for every move; higher goes first.
+         * @param board
+         * The board the moves were generated on.
+         * @param moves
+         * The moves to score.
+         * @param scores
+         * Resized and filled with one score per move.
+         * @param ply
+         * Distance from the root, selecting the killer moves.
+         * @param hashMove
+         * Move to try first, e.g. the best move of a previous iteration.
+         */
+        void scoreMoves(ChessBoard &board, const std::vector<Move> &moves, std::vector<int> &scores,
+                        int ply, const Move &hashMove = Move());
+
+        /**
+         * @brief
+         * Swaps the best-scored move among moves[index..] into moves[index].
+         * Picking one move at a time avoids sorting moves a cutoff never reaches.
+         */
+        static void pickNext(std::vector<Move> &moves, std::vector<int> &scores, size_t index);
+
+        /**
+         * @brief
+         * Records a beta cutoff. Quiet moves become killers of the ply and
+         * gain history in proportion to the remaining depth.
+         * @param moveIndex
+         * Position of the move in the searched order; 0 counts as a first-move cutoff.
+         * @param quiet
+         * Whether the move was neither a capture nor a promotion.
+         */
+        void recordCutoff(ChessBoard &board, const Move &move, int ply, int depth, size_t moveIndex, bool quiet);
+
+        /**
+         * @brief
+         * Forgets killers, history and statistics.
+         */
+        void clear();
+
+        /**
+         * @return
+         * Number of beta cutoffs recorded.
+         */
+        uint64_t getCutoffs() { return cutoffs; }
+
+        /**
+         * @return
+         * Number of beta cutoffs caused by the first move searched.
+         */
+        uint64_t getFirstMoveCutoffs() { return firstMoveCutoffs; }
+
+        /**
+         * @return
+         * Fraction of cutoffs caused by the first move, 0 without cutoffs.
+         */
+        double getFirstMoveCutoffRate() { return cutoffs ? double(firstMoveCutoffs) / cutoffs : 0.0; }
+    };
+}
+
+#endif
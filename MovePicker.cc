@@ -0,0 +1,100 @@
+#include "MovePicker.hh"
+#include "ChessBoard.hh"
+#include "MoveOrdering.hh"
+
+using Student::MovePicker;
+using Student::ChessBoard;
+using Student::ChessPiece;
+using Student::Move;
+using Student::MoveOrderer;
+
+MovePicker::MovePicker(ChessBoard &b, MoveOrderer &o, int p, const Move &hash,
+                       std::vector<Move> &moveStorage, std::vector<int> &scoreStorage, Mode m)
+  : board(b), orderer(o), ply(p), hashMove(hash), mode(m), moves(moveStorage), scores(scoreStorage)
+{
+    if (mode != Staged) stage = AllMovesStage;
+}
+
+bool MovePicker::isPlayable(const Move &move)
+{
+    if (!move.isValid()) return false;
+    ++generated;
+    ChessPiece *piece = board.getPiece(move.fromRow, move.fromColumn);
+    if (!piece || piece->getColor() != board.getTurn()) return false;
+    return board.isValidMove(move.fromRow, move.fromColumn, move.toRow, move.toColumn);
+}
+
+bool MovePicker::playedEarlier(const Move &move)
+{
+    if (move == hashMove) return true;
+    for (int i = 0; i < numKillersPlayed; ++i)
+        if (move == killersPlayed[i]) return true;
+    return false;
+}
+
+void MovePicker::generateStage()
+{
+    moves.clear();
+    switch (stage) {
+        case HashMoveStage:
+            if (isPlayable(hashMove)) moves.push_back(hashMove);
+            break;
+
+        case TacticalStage:
+            board.generateTacticalMoves(moves);
+            generated += moves.size();
+            scores.resize(moves.size());
+            for (size_t i = 0; i < moves.size(); ++i) scores[i] = MoveOrderer::scoreTactical(board, moves[i]);
+            break;
+
+        case KillerStage: {
+            // A killer that captures or promotes here came with the captures.
+            const Move *killers = orderer.getKillers(ply);
+            for (int i = 0; killers && i < 2; ++i) {
+                const Move &killer = killers[i];
+                if (killer == hashMove || !isPlayable(killer) || MoveOrderer::isTactical(board, killer)) continue;
+                killersPlayed[numKillersPlayed++] = killer;
+                moves.push_back(killer);
+            }
+            break;
+        }
+
+        case QuietStage:
+            board.generateQuietMoves(moves);
+            generated += moves.size();
+            scores.resize(moves.size());
+            for (size_t i = 0; i < moves.size(); ++i) scores[i] = orderer.scoreQuiet(board, moves[i]);
+            break;
+
+        case AllMovesStage:
+            board.generateLegalMoves(moves);
+            generated += moves.size();
+            if (mode == Eager) orderer.scoreMoves(board, moves, scores, ply, hashMove);
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool MovePicker::next(Move &move)
+{
+    while (stage != Done) {
+        if (!ready) {
+            generateStage();
+            ready = true;
+            index = 0;
+        }
+        if (index < moves.size()) {
+            bool sorted = (stage == TacticalStage || stage == QuietStage);
+            if (sorted || (stage == AllMovesStage && mode == Eager)) MoveOrderer::pickNext(moves, scores, index);
+            const Move &m = moves[index++];
+            if (sorted && playedEarlier(m)) continue;
+            move = m;
+            return true;
+        }
+        stage = (stage >= QuietStage) ? Done : Stage(stage + 1);
+        ready = false;
+    }
+    return false;
+}
@@ -0,0 +1,113 @@
+#ifndef __MOVEPICKER_H__
+#define __MOVEPICKER_H__
+
+#include "Move.hh"
+#include <cstddef>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+    class MoveOrderer;
+
+    /**
+     * @brief
+     * Hands out the moves of a position one at a time, in stages: the hash
+     * move, then captures and promotions by MVV-LVA, then the ply's killer
+     * moves, then the remaining quiet moves by history. A stage's moves are
+     * only generated once the previous stage runs out, so a node that cuts
+     * off early never generates its quiet moves at all.
+     * The hash move and killers are checked for legality before they are
+     * handed out and are not repeated by the later stages.
+     * The board must not change between calls to next, except for moves
+     * that are made and unmade again in between.
+     * For comparison it can also generate every move up front, either
+     * ordered like MoveOrderer::scoreMoves or in generation order.
+     */
+    class MovePicker
+    {
+    public:
+        enum Mode
+        {
+            Staged,
+            Eager,
+            Unordered,
+        };
+
+        enum Stage
+        {
+            HashMoveStage,
+            TacticalStage,
+            KillerStage,
+            QuietStage,
+            // Every move at once, when not staged.
+            AllMovesStage,
+            Done,
+        };
+
+    private:
+        ChessBoard &board;
+        MoveOrderer &orderer;
+        int ply;
+        Move hashMove;
+        Mode mode;
+        // The current stage's moves and their scores; borrowed from the
+        // caller so they can be reused across nodes.
+        std::vector<Move> &moves;
+        std::vector<int> &scores;
+        Stage stage = HashMoveStage;
+        // Whether the current stage's moves have been generated.
+        bool ready = false;
+        size_t index = 0;
+        // Killers already handed out, so the quiet stage can skip them.
+        Move killersPlayed[2];
+        int numKillersPlayed = 0;
+        size_t generated = 0;
+
+        bool isPlayable(const Move &move);
+        bool playedEarlier(const Move &move);
+        void generateStage();
+
+    public:
+        /**
+         * @brief
+         * Prepares to pick the moves of the side to move; nothing is
+         * generated until next is called.
+         * @param ply
+         * Distance from the root, selecting the killer moves.
+         * @param hashMove
+         * Move to try first, or an invalid move for none.
+         * @param moves
+         * Storage for the moves of one stage.
+         * @param scores
+         * Storage for their ordering scores.
+         * @param mode
+         * Whether to generate in stages or all moves at once.
+         */
+        MovePicker(ChessBoard &board, MoveOrderer &orderer, int ply, const Move &hashMove,
+                   std::vector<Move> &moves, std::vector<int> &scores, Mode mode = Staged);
+
+        /**
+         * @brief
+         * Gets the next move, generating the next stage if needed.
+         * @return
+         * Returns false once every legal move has been handed out.
+         */
+        bool next(Move &move);
+
+        /**
+         * @return
+         * Stage of the move returned last.
+         */
+        Stage getStage() { return stage; }
+
+        /**
+         * @return
+         * Number of moves generated so far, counting the hash move and
+         * killers that were checked.
+         */
+        size_t getGenerated() { return generated; }
+    };
+}
+
+#endif
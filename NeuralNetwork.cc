@@ -0,0 +1,379 @@
+#include "NeuralNetwork.hh"
+#include "ChessBoard.hh"
+#include <algorithm>
+#include <fstream>
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define NEURAL_SIMD
+#include <immintrin.h>
+#endif
+
+using Student::NeuralNetwork;
+using Student::NeuralAccumulator;
+using Student::ChessBoard;
+using Student::ChessPiece;
+
+namespace
+{
+    const uint32_t FileVersion = 1;
+    const char FileMagic[4] = {'B', 'C', 'N', 'N'};
+    const int MaxAccumulatorSize = 1024;
+    // Bounds the first layer, and so the size of a file we agree to read.
+    const size_t MaxFeatureWeights = size_t(1) << 26;
+    // Hidden sums are divided by 2^HiddenShift before clipping.
+    const int HiddenShift = 6;
+    const int ClipMax = 127;
+
+    template <typename T>
+    void writeValues(std::ostream &out, const T *values, size_t count)
+    {
+        out.write(reinterpret_cast<const char *>(values), std::streamsize(sizeof(T) * count));
+    }
+
+    template <typename T>
+    bool readValues(std::istream &in, T *values, size_t count)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(values), std::streamsize(sizeof(T) * count)));
+    }
+
+    namespace ScalarKernel
+    {
+        void update(int size, const int16_t *weights, const int16_t *from, int16_t *to, const int *added,
+                    int numAdded, const int *removed, int numRemoved)
+        {
+            for (int i = 0; i < size; ++i) {
+                int16_t v = from[i];
+                for (int a = 0; a < numAdded; ++a) v = int16_t(v + weights[size_t(added[a]) * size + i]);
+                for (int r = 0; r < numRemoved; ++r) v = int16_t(v - weights[size_t(removed[r]) * size + i]);
+                to[i] = v;
+            }
+        }
+
+        void clip(int size, const int16_t *accumulator, uint8_t *input)
+        {
+            for (int i = 0; i < size; ++i) input[i] = uint8_t(std::min<int>(std::max<int>(accumulator[i], 0), ClipMax));
+        }
+
+        int32_t dot(const uint8_t *input, const int8_t *weights, int length)
+        {
+            int32_t sum = 0;
+            for (int i = 0; i < length; ++i) sum += int32_t(input[i]) * weights[i];
+            return sum;
+        }
+    }
+
+#ifdef NEURAL_SIMD
+#pragma GCC push_options
+#pragma GCC target("avx2")
+    namespace Avx2Kernel
+    {
+        // 16 accumulator entries per step.
+        void update(int size, const int16_t *weights, const int16_t *from, int16_t *to, const int *added,
+                    int numAdded, const int *removed, int numRemoved)
+        {
+            for (int i = 0; i < size; i += 16) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + i));
+                for (int a = 0; a < numAdded; ++a) {
+                    const int16_t *row = weights + size_t(added[a]) * size + i;
+                    v = _mm256_add_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row)));
+                }
+                for (int r = 0; r < numRemoved; ++r) {
+                    const int16_t *row = weights + size_t(removed[r]) * size + i;
+                    v = _mm256_sub_epi16(v, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row)));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(to + i), v);
+            }
+        }
+
+        void clip(int size, const int16_t *accumulator, uint8_t *input)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i top = _mm256_set1_epi16(ClipMax);
+            for (int i = 0; i < size; i += 32) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i + 16));
+                a = _mm256_min_epi16(_mm256_max_epi16(a, zero), top);
+                b = _mm256_min_epi16(_mm256_max_epi16(b, zero), top);
+                // Packing works within 128-bit halves; the permute restores the order.
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(input + i), packed);
+            }
+        }
+
+        // Inputs are at most 127, so the pairwise sums of maddubs never saturate.
+        int32_t dot(const uint8_t *input, const int8_t *weights, int length)
+        {
+            const __m256i ones = _mm256_set1_epi16(1);
+            __m256i sum = _mm256_setzero_si256();
+            for (int i = 0; i < length; i += 32) {
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+                __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i));
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+            }
+            __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+            half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+            return _mm_cvtsi128_si32(half);
+        }
+    }
+#pragma GCC pop_options
+#endif
+}
+
+NeuralNetwork::NeuralNetwork()
+{
+    kernel = isSupported(AVX2) ? AVX2 : Scalar;
+}
+
+bool NeuralNetwork::resize(int rows, int cols, int size)
+{
+    accumulatorSize = 0;
+    if (rows <= 0 || cols <= 0 || size <= 0 || size > MaxAccumulatorSize || size % 32 != 0) return false;
+    size_t features = size_t(12) * rows * cols;
+    if (features * size > MaxFeatureWeights) return false;
+
+    numRows = rows;
+    numCols = cols;
+    numFeatures = int(features);
+    featureBiases.assign(size, 0);
+    featureWeights.assign(features * size, 0);
+    hiddenBiases.assign(HiddenSize, 0);
+    hiddenWeights.assign(size_t(HiddenSize) * 2 * size, 0);
+    outputBias = 0;
+    outputWeights.assign(HiddenSize, 0);
+    accumulatorSize = size;
+    return true;
+}
+
+bool NeuralNetwork::load(const std::string &path)
+{
+    accumulatorSize = 0;
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t version;
+    int32_t rows, cols, size;
+    float scale;
+    if (!readValues(in, magic, 4) || !std::equal(magic, magic + 4, FileMagic)) return false;
+    if (!readValues(in, &version, 1) || version != FileVersion) return false;
+    if (!readValues(in, &rows, 1) || !readValues(in, &cols, 1) || !readValues(in, &size, 1) ||
+        !readValues(in, &scale, 1))
+        return false;
+    if (!resize(rows, cols, size)) return false;
+
+    outputScale = scale;
+    bool ok = readValues(in, featureBiases.data(), featureBiases.size()) &&
+              readValues(in, featureWeights.data(), featureWeights.size()) &&
+              readValues(in, hiddenBiases.data(), hiddenBiases.size()) &&
+              readValues(in, hiddenWeights.data(), hiddenWeights.size()) &&
+              readValues(in, &outputBias, 1) &&
+              readValues(in, outputWeights.data(), outputWeights.size());
+    if (!ok) accumulatorSize = 0;
+    return ok;
+}
+
+bool NeuralNetwork::save(const std::string &path)
+{
+    if (!isLoaded()) return false;
+    std::ofstream out(path, std::ios::binary);
+    int32_t header[3] = {numRows, numCols, accumulatorSize};
+    writeValues(out, FileMagic, 4);
+    writeValues(out, &FileVersion, 1);
+    writeValues(out, header, 3);
+    writeValues(out, &outputScale, 1);
+    writeValues(out, featureBiases.data(), featureBiases.size());
+    writeValues(out, featureWeights.data(), featureWeights.size());
+    writeValues(out, hiddenBiases.data(), hiddenBiases.size());
+    writeValues(out, hiddenWeights.data(), hiddenWeights.size());
+    writeValues(out, &outputBias, 1);
+    writeValues(out, outputWeights.data(), outputWeights.size());
+    return static_cast<bool>(out);
+}
+
+bool NeuralNetwork::randomise(int rows, int cols, int size, uint32_t seed)
+{
+    if (!resize(rows, cols, (size + 31) / 32 * 32)) return false;
+
+    // xorshift32; any nonzero state will do.
+    uint32_t state = seed ? seed : 1;
+    auto next = [&](int low, int high) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return low + int(state % uint32_t(high - low + 1));
+    };
+    for (int16_t &b : featureBiases) b = int16_t(next(0, 32));
+    for (int16_t &w : featureWeights) w = int16_t(next(-8, 8));
+    for (int32_t &b : hiddenBiases) b = next(-256, 256);
+    for (int8_t &w : hiddenWeights) w = int8_t(next(-16, 16));
+    outputBias = 0;
+    for (int8_t &w : outputWeights) w = int8_t(next(-32, 32));
+    outputScale = 1.0f / 512.0f;
+    return true;
+}
+
+void NeuralNetwork::update(const int16_t *from, int16_t *to, const int *added, int numAdded, const int *removed,
+                           int numRemoved)
+{
+    if (!from) from = featureBiases.data();
+#ifdef NEURAL_SIMD
+    if (kernel == AVX2) {
+        Avx2Kernel::update(accumulatorSize, featureWeights.data(), from, to, added, numAdded, removed, numRemoved);
+        return;
+    }
+#endif
+    ScalarKernel::update(accumulatorSize, featureWeights.data(), from, to, added, numAdded, removed, numRemoved);
+}
+
+float NeuralNetwork::evaluate(const int16_t *sideToMove, const int16_t *opponent)
+{
+    const int length = 2 * accumulatorSize;
+    uint8_t input[2 * MaxAccumulatorSize];
+    int32_t hidden[HiddenSize];
+#ifdef NEURAL_SIMD
+    if (kernel == AVX2) {
+        Avx2Kernel::clip(accumulatorSize, sideToMove, input);
+        Avx2Kernel::clip(accumulatorSize, opponent, input + accumulatorSize);
+        for (int o = 0; o < HiddenSize; ++o)
+            hidden[o] = hiddenBiases[o] + Avx2Kernel::dot(input, &hiddenWeights[size_t(o) * length], length);
+    } else
+#endif
+    {
+        ScalarKernel::clip(accumulatorSize, sideToMove, input);
+        ScalarKernel::clip(accumulatorSize, opponent, input + accumulatorSize);
+        for (int o = 0; o < HiddenSize; ++o)
+            hidden[o] = hiddenBiases[o] + ScalarKernel::dot(input, &hiddenWeights[size_t(o) * length], length);
+    }
+
+    int32_t output = outputBias;
+    for (int o = 0; o < HiddenSize; ++o)
+        output += std::min(std::max(hidden[o] >> HiddenShift, 0), ClipMax) * outputWeights[o];
+    return float(output) * outputScale;
+}
+
+bool NeuralNetwork::setKernel(Kernel k)
+{
+    if (!isSupported(k)) return false;
+    kernel = k;
+    return true;
+}
+
+bool NeuralNetwork::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+        case Scalar: return true;
+#ifdef NEURAL_SIMD
+        case AVX2:   return __builtin_cpu_supports("avx2");
+#endif
+        default:     return false;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// ACCUMULATOR STACK
+// ----------------------------------------------------------------------------
+
+NeuralAccumulator::NeuralAccumulator(NeuralNetwork &n)
+  : network(n)
+{
+    entries.resize(1);
+    entries[0].values.resize(2 * size_t(network.getAccumulatorSize()));
+}
+
+void NeuralAccumulator::reset()
+{
+    top = 0;
+    entries[0].computed = false;
+}
+
+void NeuralAccumulator::push()
+{
+    if (++top == entries.size()) {
+        entries.emplace_back();
+        entries.back().values.resize(2 * size_t(network.getAccumulatorSize()));
+    }
+    Entry &entry = entries[top];
+    entry.computed = false;
+    entry.overflowed = false;
+    entry.numRemoved = 0;
+    entry.numAdded = 0;
+}
+
+void NeuralAccumulator::pop()
+{
+    if (top > 0) --top;
+    else reset();
+}
+
+void NeuralAccumulator::removePiece(Color color, Type type, int row, int column)
+{
+    Entry &entry = entries[top];
+    // Without a move to attach the change to, the bottom entry is summed afresh.
+    if (top == 0) entry.computed = false;
+    else if (entry.numRemoved == 3) entry.overflowed = true;
+    else entry.removed[entry.numRemoved++] = {color, type, row, column};
+}
+
+void NeuralAccumulator::addPiece(Color color, Type type, int row, int column)
+{
+    Entry &entry = entries[top];
+    if (top == 0) entry.computed = false;
+    else if (entry.numAdded == 2) entry.overflowed = true;
+    else entry.added[entry.numAdded++] = {color, type, row, column};
+}
+
+void NeuralAccumulator::refresh(ChessBoard &board, Entry &entry)
+{
+    const int size = network.getAccumulatorSize();
+    for (Color perspective : {White, Black}) {
+        features.clear();
+        for (int sq : board.getPieceSquares()) {
+            ChessPiece *p = board.pieceOn(sq);
+            features.push_back(network.featureIndex(perspective, p->getColor(), p->getType(), board.getRowOf(sq),
+                                                    board.getColumnOf(sq)));
+        }
+        int16_t *values = entry.values.data() + (perspective == White ? 0 : size);
+        network.update(nullptr, values, features.data(), int(features.size()), nullptr, 0);
+    }
+    entry.computed = true;
+}
+
+void NeuralAccumulator::apply(const Entry &below, Entry &entry)
+{
+    const int size = network.getAccumulatorSize();
+    for (Color perspective : {White, Black}) {
+        int added[2], removed[3];
+        for (int i = 0; i < entry.numAdded; ++i) {
+            const PieceChange &p = entry.added[i];
+            added[i] = network.featureIndex(perspective, p.color, p.type, p.row, p.column);
+        }
+        for (int i = 0; i < entry.numRemoved; ++i) {
+            const PieceChange &p = entry.removed[i];
+            removed[i] = network.featureIndex(perspective, p.color, p.type, p.row, p.column);
+        }
+        int offset = (perspective == White) ? 0 : size;
+        network.update(below.values.data() + offset, entry.values.data() + offset, added, entry.numAdded, removed,
+                       entry.numRemoved);
+    }
+    entry.computed = true;
+}
+
+float NeuralAccumulator::evaluate(ChessBoard &board)
+{
+    // Walk down to the nearest entry that is up to date and apply the moves
+    // since, unless the way down is broken; then sum the board afresh.
+    size_t base = top;
+    while (!entries[base].computed) {
+        if (base == 0 || entries[base].overflowed) {
+            refresh(board, entries[top]);
+            base = top;
+            break;
+        }
+        --base;
+    }
+    for (size_t i = base + 1; i <= top; ++i) apply(entries[i - 1], entries[i]);
+
+    const int size = network.getAccumulatorSize();
+    const int16_t *white = entries[top].values.data();
+    const int16_t *black = white + size;
+    return (board.getTurn() == White) ? network.evaluate(white, black) : network.evaluate(black, white);
+}
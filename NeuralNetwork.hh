@@ -0,0 +1,233 @@
+#ifndef __NEURALNETWORK_H__
+#define __NEURALNETWORK_H__
+
+#include "Chess.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Weights of a small efficiently updatable evaluation network for one
+     * board size. The input is one feature per (piece colour, piece type,
+     * square), seen from each side: colours are relative to that side and
+     * rows are flipped for Black, so both sides see their pieces advance
+     * up the board. The first layer sums the weights of the features present
+     * into an int16 accumulator per side, which boards keep up to date move
+     * by move (see NeuralAccumulator). Both accumulators, the side to move's
+     * first, are clipped to [0, 127] and fed through a 32-wide int8 layer
+     * and an int8 output neuron.
+     * Weights are loaded from a file and not changed afterwards, so one
+     * network may serve boards on many threads.
+     */
+    class NeuralNetwork
+    {
+    public:
+        enum Kernel
+        {
+            Scalar,
+            AVX2,
+        };
+
+        // Width of the second layer.
+        static const int HiddenSize = 32;
+
+    private:
+        int numRows = 0;
+        int numCols = 0;
+        // Width of each side's accumulator, a multiple of 32.
+        int accumulatorSize = 0;
+        int numFeatures = 0;
+        // Multiplies the output neuron into pawns.
+        float outputScale = 0.0f;
+        std::vector<int16_t> featureBiases;
+        // accumulatorSize weights per feature.
+        std::vector<int16_t> featureWeights;
+        std::vector<int32_t> hiddenBiases;
+        // 2 * accumulatorSize weights per hidden neuron.
+        std::vector<int8_t> hiddenWeights;
+        int32_t outputBias = 0;
+        std::vector<int8_t> outputWeights;
+        Kernel kernel = Scalar;
+
+        bool resize(int numRows, int numCols, int accumulatorSize);
+
+    public:
+        /**
+         * @brief
+         * Creates a network without weights; load or randomise it before use.
+         */
+        NeuralNetwork();
+
+        /**
+         * @brief
+         * Reads weights written by save.
+         * @return
+         * Returns false, leaving the network empty, if the file is missing,
+         * truncated or not a network file.
+         */
+        bool load(const std::string &path);
+
+        /**
+         * @brief
+         * Writes the weights to a file.
+         * @return
+         * Returns false if the network is empty or the file cannot be written.
+         */
+        bool save(const std::string &path);
+
+        /**
+         * @brief
+         * Fills the network with small pseudo-random weights, for testing
+         * and timing; they do not play well.
+         * @param accumulatorSize
+         * Width of each side's accumulator, rounded up to a multiple of 32.
+         * @return
+         * Returns false if the sizes are out of range.
+         */
+        bool randomise(int numRows, int numCols, int accumulatorSize, uint32_t seed);
+
+        /**
+         * @return
+         * Returns true once weights have been loaded.
+         */
+        bool isLoaded() { return accumulatorSize > 0; }
+
+        int getNumRows() { return numRows; }
+        int getNumCols() { return numCols; }
+        int getAccumulatorSize() { return accumulatorSize; }
+
+        /**
+         * @return
+         * Index of the feature of a piece on a square, from a side's point
+         * of view.
+         */
+        int featureIndex(Color perspective, Color color, Type type, int row, int column)
+        {
+            int relative = (color == perspective) ? 0 : 1;
+            int r = (perspective == White) ? row : (numRows - 1 - row);
+            return (relative * 6 + type) * (numRows * numCols) + r * numCols + column;
+        }
+
+        /**
+         * @brief
+         * Sets one side's accumulator to another's plus the weights of the
+         * added features and minus those of the removed ones.
+         * @param from
+         * The accumulator to start from, or nullptr to start from the biases.
+         */
+        void update(const int16_t *from, int16_t *to, const int *added, int numAdded, const int *removed,
+                    int numRemoved);
+
+        /**
+         * @brief
+         * Runs the layers after the accumulators.
+         * @return
+         * Score in pawns from the side to move's point of view.
+         */
+        float evaluate(const int16_t *sideToMove, const int16_t *opponent);
+
+        /**
+         * @brief
+         * Selects the kernel used from now on. Every kernel gives the same
+         * results; defaults to the fastest the CPU can run.
+         * @return
+         * Returns false, keeping the current kernel, if the CPU cannot run it.
+         */
+        bool setKernel(Kernel k);
+        Kernel getKernel() { return kernel; }
+
+        /**
+         * @return
+         * Returns true if this build and CPU can run the kernel.
+         */
+        static bool isSupported(Kernel kernel);
+    };
+
+    /**
+     * @brief
+     * A board's first-layer accumulators, kept in step with its moves. Each
+     * move made with makeMove pushes an entry recording which pieces came
+     * and went, and unmakeMove pops it again; entries are brought up to date
+     * from the one below only when the position is evaluated, so interior
+     * search nodes cost nothing. Any other change to the board resets the
+     * stack, and the next evaluation sums the features from scratch.
+     */
+    class NeuralAccumulator
+    {
+    private:
+        struct PieceChange
+        {
+            Color color;
+            Type type;
+            int row;
+            int column;
+        };
+
+        struct Entry
+        {
+            // White's accumulator, then Black's.
+            std::vector<int16_t> values;
+            bool computed = false;
+            // Set when the changes did not fit; computed from the board then.
+            bool overflowed = false;
+            PieceChange removed[3];
+            PieceChange added[2];
+            int numRemoved = 0;
+            int numAdded = 0;
+        };
+
+        NeuralNetwork &network;
+        std::vector<Entry> entries;
+        size_t top = 0;
+        // Features of the whole board when refreshing, kept to avoid allocating.
+        std::vector<int> features;
+
+        void refresh(ChessBoard &board, Entry &entry);
+        void apply(const Entry &below, Entry &entry);
+
+    public:
+        /**
+         * @brief
+         * Creates an empty stack for boards of the network's size.
+         */
+        explicit NeuralAccumulator(NeuralNetwork &network);
+
+        /**
+         * @brief
+         * Forgets every entry; the position changed in some other way than
+         * by a move.
+         */
+        void reset();
+
+        /**
+         * @brief
+         * Starts an entry for a move; its changes follow with removePiece
+         * and addPiece.
+         */
+        void push();
+
+        /**
+         * @brief
+         * Drops the entry of the move taken back last.
+         */
+        void pop();
+
+        void removePiece(Color color, Type type, int row, int column);
+        void addPiece(Color color, Type type, int row, int column);
+
+        /**
+         * @return
+         * The network's score of the board's position, from the side to
+         * move's point of view.
+         */
+        float evaluate(ChessBoard &board);
+    };
+}
+
+#endif
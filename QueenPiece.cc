@@ -29,30 +29,19 @@ bool QueenPiece::canMoveToLocation(int toRow, int toColumn)
   if (!isStraight && !isDiagonal) return false;
 
   // 3. Check for obstructions along the path
-  // Determine direction of movement (-1, 0, or 1)
-  int rowStep = (dr == 0) ? 0 : (dr > 0 ? 1 : -1);
-  int colStep = (dc == 0) ? 0 : (dc > 0 ? 1 : -1);
-
-  int checkRow = row + rowStep;
-  int checkCol = column + colStep;
-
-  // Loop through all squares between start and end (exclusive of end)
-  while (checkRow != toRow || checkCol != toColumn) {
-    if (board->getPiece(checkRow, checkCol) != nullptr) {
-      return false; // Path is blocked
-    }
-    checkRow += rowStep;
-    checkCol += colStep;
+  // The destination is fetched first, with a bounds check; the board then
+  // answers from its attack tables or by walking the squares in between.
+  ChessPiece* destination = board->getPiece(toRow, toColumn);
+  if (!board->isLineClear(row, column, toRow, toColumn)) {
+    return false; // Path is blocked
   }
 
   // 4. Check the destination square
-  ChessPiece* target = board->getPiece(toRow, toColumn);
-  
   // If empty, move is valid
-  if (target == nullptr) return true;
+  if (destination == nullptr) return true;
 
   // If occupied, can only capture if it's the opponent's color
-  if (target->getColor() != color) return true;
+  if (destination->getColor() != color) return true;
 
   // If occupied by same color, invalid
   return false;
@@ -0,0 +1,272 @@
+#include "Search.hh"
+#include "ChessBoard.hh"
+#include "Tablebase.hh"
+#include "Stats.hh"
+#include <algorithm>
+
+using Student::Search;
+using Student::SearchResult;
+using Student::ChessBoard;
+using Student::ChessPiece;
+using Student::Move;
+using Student::MoveUndo;
+using Student::MoveOrderer;
+using Student::MovePicker;
+using Student::TablebaseResult;
+
+namespace
+{
+    const float Infinity = 1e9f;
+    // Slack for the mobility term when deciding a capture cannot reach alpha.
+    const float DeltaMargin = 2.0f;
+    // Room reserved per ply so move lists rarely need to grow.
+    const size_t MovesPerPly = 256;
+    // Width of the windows that only ask whether a score beats a bound.
+    const float NullWindow = 0.01f;
+    // Null-move searches are this many plies shallower than the node, or one
+    // more from NullMoveDeepDepth on.
+    const int NullMoveMinDepth = 2;
+    const int NullMoveReduction = 2;
+    const int NullMoveDeepDepth = 7;
+    // Quiet moves from this rank on are reduced by a ply, and from
+    // LateMoveDeepIndex on by two, at depths of LateMoveMinDepth or more.
+    const int LateMoveMinDepth = 3;
+    const size_t LateMoveIndex = 3;
+    const size_t LateMoveDeepIndex = 8;
+    // How far a quiet move may lift scoreBoard, by remaining depth; deeper
+    // nodes are never pruned as futile.
+    const float FutilityMargins[] = {0.0f, 2.0f, 4.0f};
+    const int FutilityMaxDepth = 2;
+    // Scores above this are mates, found by the search or in a tablebase.
+    const float MateBound = Search::MateScore - MoveOrderer::MaxPly - TablebaseResult::MaxDistance;
+
+    // A tablebase result scored like a mate the search found itself, at
+    // the ply the mate falls on.
+    float tablebaseScore(const TablebaseResult &result, int ply)
+    {
+        return int(result.outcome) * (Search::MateScore - float(ply + result.distanceToMate));
+    }
+}
+
+Search::Search(ChessBoard &b)
+  : board(b), orderer(b.getNumRows(), b.getNumCols())
+{
+    moveStack.resize(MoveOrderer::MaxPly + 1);
+    scoreStack.resize(MoveOrderer::MaxPly + 1);
+    for (int ply = 0; ply <= MoveOrderer::MaxPly; ++ply) {
+        moveStack[ply].reserve(MovesPerPly);
+        scoreStack[ply].reserve(MovesPerPly);
+    }
+}
+
+SearchResult Search::search(int depth, const Callback &onIteration)
+{
+    STATS_TIME(SearchTime);
+    SearchResult result;
+    auto begin = std::chrono::steady_clock::now();
+    nodes = 0;
+    generatedMoves = 0;
+    nullMoveCutoffs = reducedMoves = futilityPrunes = exchangePrunes = 0;
+    aborted = false;
+    if (depth > MoveOrderer::MaxPly) depth = MoveOrderer::MaxPly;
+    // On large boards a single node's generation and evaluation take too
+    // long to only check for a stop between nodes.
+    board.setInterruptCheck([this] {
+        if (!aborted && shouldStop()) aborted = true;
+        return aborted;
+    });
+
+    for (int d = 1; d <= depth; ++d) {
+        rootHashMove = result.bestMove;
+        rootBest = Move();
+        float score = alphaBeta(d, -Infinity, Infinity, 0, false);
+        if (aborted) {
+            // Root moves searched before the stop are still sound.
+            if (!result.bestMove.isValid() && rootBest.isValid()) {
+                result.bestMove = rootBest;
+                result.score = rootBestScore;
+            }
+            break;
+        }
+        if (!rootBest.isValid()) break;  // no legal moves
+        result.bestMove = rootBest;
+        result.score = score;
+        result.depth = d;
+        result.nodes = nodes;
+        result.generatedMoves = generatedMoves;
+        result.nullMoveCutoffs = nullMoveCutoffs;
+        result.reducedMoves = reducedMoves;
+        result.futilityPrunes = futilityPrunes;
+        result.exchangePrunes = exchangePrunes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        if (onIteration) onIteration(result);
+    }
+    if (!result.bestMove.isValid() && !aborted) result.score = board.isInCheck() ? -MateScore : 0.0f;
+    result.nodes = nodes;
+    result.generatedMoves = generatedMoves;
+    result.nullMoveCutoffs = nullMoveCutoffs;
+    result.reducedMoves = reducedMoves;
+    result.futilityPrunes = futilityPrunes;
+    result.exchangePrunes = exchangePrunes;
+    if (aborted) result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.stopped = aborted;
+    board.setInterruptCheck(std::function<bool()>());
+    stopRequested.store(false, std::memory_order_relaxed);
+    return result;
+}
+
+bool Search::shouldStop()
+{
+    if (stopRequested.load(std::memory_order_relaxed)) return true;
+    if (nodeLimit && nodes > nodeLimit) return true;
+    std::chrono::steady_clock::rep until = deadline.load(std::memory_order_relaxed);
+    return until != NoDeadline && std::chrono::steady_clock::now().time_since_epoch().count() >= until;
+}
+
+float Search::alphaBeta(int depth, float alpha, float beta, int ply, bool allowNullMove)
+{
+    ++nodes;
+    STATS_COUNT(NodesSearched);
+    if (aborted || shouldStop()) {
+        aborted = true;
+        return 0.0f;
+    }
+
+    Tablebase *tablebase = board.getTablebase();
+    TablebaseResult tbResult;
+    if (ply > 0 && tablebase && tablebase->probe(board, board.getTurn(), tbResult)) return tablebaseScore(tbResult, ply);
+
+    if (ply >= MoveOrderer::MaxPly) return board.scoreBoard();
+    if (depth <= 0) return useQuiescence ? quiesce(alpha, beta, ply) : board.scoreBoard();
+
+    bool inCheck = board.isInCheck();
+    bool futilityNode = useFutility && ply > 0 && depth <= FutilityMaxDepth && !inCheck;
+    bool nullMoveNode = useNullMove && allowNullMove && depth >= NullMoveMinDepth && !inCheck &&
+                        beta < MateBound && board.hasNonPawnMaterial(board.getTurn());
+    float staticScore = (futilityNode || nullMoveNode) ? board.scoreBoard() : 0.0f;
+
+    // Null move: if the opponent cannot make up for a free move even in a
+    // shallower search, no move of ours will fall below beta either.
+    if (nullMoveNode && staticScore >= beta) {
+        int reduction = NullMoveReduction + (depth >= NullMoveDeepDepth ? 1 : 0);
+        MoveUndo undo;
+        board.makeNullMove(undo);
+        float score = -alphaBeta(depth - 1 - reduction, -beta, -beta + NullWindow, ply + 1, false);
+        board.unmakeNullMove(undo);
+        if (aborted) return 0.0f;
+        if (score >= beta) {
+            ++nullMoveCutoffs;
+            return beta;
+        }
+    }
+
+    MovePicker::Mode mode = !useOrdering ? MovePicker::Unordered : (useStagedGeneration ? MovePicker::Staged : MovePicker::Eager);
+    MovePicker picker(board, orderer, ply, ply == 0 ? rootHashMove : Move(), moveStack[ply], scoreStack[ply], mode);
+
+    float best = -Infinity;
+    size_t searched = 0;
+    Move m;
+    while (picker.next(m)) {
+        size_t index = searched++;
+        bool quiet = !MoveOrderer::isTactical(board, m);
+
+        // Futility: a quiet move this close to the leaves is not expected to
+        // gain more than the margin. Its bound still counts towards best, so
+        // a node whose moves are all skipped is not taken for a mate.
+        if (futilityNode && quiet && index > 0 && staticScore + FutilityMargins[depth] <= alpha) {
+            ++futilityPrunes;
+            if (staticScore + FutilityMargins[depth] > best) best = staticScore + FutilityMargins[depth];
+            continue;
+        }
+
+        int reduction = 0;
+        if (useLateMoveReductions && useOrdering && ply > 0 && quiet && !inCheck && depth >= LateMoveMinDepth &&
+            index >= LateMoveIndex && picker.getStage() != MovePicker::KillerStage) {
+            reduction = std::min(index >= LateMoveDeepIndex ? 2 : 1, depth - 2);
+        }
+
+        MoveUndo undo;
+        board.makeMove(m, undo);
+        float score;
+        if (reduction > 0) {
+            // Only worth a full search if the shallow one raises alpha.
+            ++reducedMoves;
+            score = -alphaBeta(depth - 1 - reduction, -alpha - NullWindow, -alpha, ply + 1, true);
+            if (!aborted && score > alpha) score = -alphaBeta(depth - 1, -beta, -alpha, ply + 1, true);
+        } else {
+            score = -alphaBeta(depth - 1, -beta, -alpha, ply + 1, true);
+        }
+        board.unmakeMove(m, undo);
+        if (aborted) return 0.0f;
+
+        if (score > best) {
+            best = score;
+            if (ply == 0) {
+                rootBest = m;
+                rootBestScore = score;
+            }
+        }
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) {
+            orderer.recordCutoff(board, m, ply, depth, index, quiet);
+            break;
+        }
+    }
+    generatedMoves += picker.getGenerated();
+    if (searched == 0) return inCheck ? -(MateScore - ply) : 0.0f;
+    return best;
+}
+
+float Search::quiesce(float alpha, float beta, int ply)
+{
+    ++nodes;
+    STATS_COUNT(NodesSearched);
+    if (aborted || shouldStop()) {
+        aborted = true;
+        return 0.0f;
+    }
+
+    // Stand pat: the side to move need not capture at all.
+    float best = board.scoreBoard();
+    if (best >= beta || ply >= MoveOrderer::MaxPly) return best;
+    if (best > alpha) alpha = best;
+
+    std::vector<Move> &moves = moveStack[ply];
+    std::vector<int> &scores = scoreStack[ply];
+    board.generateTacticalMoves(moves);
+    generatedMoves += moves.size();
+    orderer.scoreMoves(board, moves, scores, ply);
+
+    for (size_t i = 0; i < moves.size(); ++i) {
+        MoveOrderer::pickNext(moves, scores, i);
+        Move m = moves[i];
+
+        // Delta pruning: skip captures that cannot lift the score to alpha
+        // even if the capturing piece is never taken back.
+        ChessPiece *victim = board.getPiece(m.toRow, m.toColumn);
+        float gain = victim ? board.getPieceValue(victim->getType()) : 0.0f;
+        if (!victim && m.fromColumn != m.toColumn) gain = board.getPieceValue(Pawn);
+        bool promotion = board.getPiece(m.fromRow, m.fromColumn)->getType() == Pawn &&
+                         (m.toRow == 0 || m.toRow == board.getNumRows() - 1);
+        if (promotion) gain += board.getPieceValue(Queen) - board.getPieceValue(Pawn);
+        if (best + gain + DeltaMargin <= alpha) continue;
+
+        // Captures that lose material once the exchange on the square is
+        // played out are not worth a search.
+        if (useExchangePruning && !promotion && board.exchangeValue(m) < 0) {
+            ++exchangePrunes;
+            continue;
+        }
+
+        MoveUndo undo;
+        board.makeMove(m, undo);
+        float score = -quiesce(-beta, -alpha, ply + 1);
+        board.unmakeMove(m, undo);
+        if (aborted) return 0.0f;
+
+        if (score > best) best = score;
+        if (score > alpha) alpha = score;
+        if (alpha >= beta) break;
+    }
+    return best;
+}
@@ -0,0 +1,229 @@
+#ifndef __SEARCH_H__
+#define __SEARCH_H__
+
+#include "Move.hh"
+#include "MoveOrdering.hh"
+#include "MovePicker.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Outcome of a search.
+     */
+    struct SearchResult
+    {
+        Move bestMove;
+        // Score of the best move from the side to move's point of view.
+        float score = 0.0f;
+        // Deepest completed iteration.
+        int depth = 0;
+        // Positions visited over all iterations.
+        uint64_t nodes = 0;
+        // Moves generated over all iterations, hash moves and killers included.
+        uint64_t generatedMoves = 0;
+        // Nodes cut off by a null move, moves searched at reduced depth,
+        // moves skipped as futile and captures skipped as losing the
+        // exchange, over all iterations.
+        uint64_t nullMoveCutoffs = 0;
+        uint64_t reducedMoves = 0;
+        uint64_t futilityPrunes = 0;
+        uint64_t exchangePrunes = 0;
+        // Seconds from the start of the search to the end of the deepest
+        // completed iteration, or to the stop.
+        double seconds = 0.0;
+        // Whether the search was stopped or ran out of time before finishing.
+        bool stopped = false;
+    };
+
+    /**
+     * @brief
+     * Iterative-deepening alpha-beta (negamax) search over a ChessBoard.
+     * The search plays moves with makeMove/unmakeMove on the board it was
+     * given, so the board must not be touched while a search runs; it is
+     * left unchanged afterwards. Leaves are extended by a quiescence search
+     * over captures and promotions before being scored with scoreBoard, and
+     * positions covered by the board's tablebase are scored from the table.
+     * Moves are generated in stages by a MovePicker, so nodes that cut off
+     * early skip generating their quiet moves. Move lists are kept per ply,
+     * so once they have grown the search does not allocate.
+     * Selective techniques trade exactness for depth, each of which can be
+     * turned off: null-move pruning, late-move reductions, futility pruning
+     * near the leaves and skipping captures that lose the exchange.
+     */
+    class Search
+    {
+    private:
+        ChessBoard &board;
+        MoveOrderer orderer;
+        bool useOrdering = true;
+        bool useStagedGeneration = true;
+        bool useQuiescence = true;
+        bool useNullMove = true;
+        bool useLateMoveReductions = true;
+        bool useFutility = true;
+        bool useExchangePruning = true;
+        uint64_t nodes = 0;
+        uint64_t generatedMoves = 0;
+        uint64_t nullMoveCutoffs = 0;
+        uint64_t reducedMoves = 0;
+        uint64_t futilityPrunes = 0;
+        uint64_t exchangePrunes = 0;
+        Move rootBest;
+        float rootBestScore = 0.0f;
+        // Best move of the previous iteration, tried first at the root.
+        Move rootHashMove;
+        // Move lists and ordering scores per ply, reused across nodes.
+        std::vector<std::vector<Move>> moveStack;
+        std::vector<std::vector<int>> scoreStack;
+        // Set from other threads; polled at every node.
+        std::atomic<bool> stopRequested{false};
+        static constexpr std::chrono::steady_clock::rep NoDeadline = std::numeric_limits<std::chrono::steady_clock::rep>::max();
+        std::atomic<std::chrono::steady_clock::rep> deadline{NoDeadline};
+        // Nodes per call to search, or 0 for no limit.
+        uint64_t nodeLimit = 0;
+        bool aborted = false;
+
+        bool shouldStop();
+        float alphaBeta(int depth, float alpha, float beta, int ply, bool allowNullMove);
+        float quiesce(float alpha, float beta, int ply);
+
+    public:
+        // Score of being mated on the spot; mates further away score closer to 0.
+        static constexpr float MateScore = 10000.0f;
+
+        /**
+         * @brief
+         * Creates a search over a board.
+         * @param board
+         * The board to search. Must outlive the search.
+         */
+        explicit Search(ChessBoard &board);
+
+        using Callback = std::function<void(const SearchResult &)>;
+
+        /**
+         * @brief
+         * Searches the side to move's position to a fixed depth, one
+         * iteration per depth; each iteration tries the previous best move first.
+         * A stopped search returns the deepest completed iteration, or the best
+         * root move found so far if not even the first one completed.
+         * @param depth
+         * Number of plies to search, at least 1.
+         * @param onIteration
+         * Called with the result so far after every completed iteration.
+         */
+        SearchResult search(int depth, const Callback &onIteration = Callback());
+
+        /**
+         * @brief
+         * Stops the running search at its next node. Safe to call from any
+         * thread; a stop requested while no search runs cancels the next one.
+         */
+        void stop() { stopRequested.store(true, std::memory_order_relaxed); }
+
+        /**
+         * @brief
+         * Sets the point in time at which searches give up. Safe to call from
+         * any thread, also while a search runs. Defaults to no deadline.
+         */
+        void setDeadline(std::chrono::steady_clock::time_point when)
+        {
+            deadline.store(when.time_since_epoch().count(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief
+         * Limits every search to a number of nodes, after which it stops as
+         * if the deadline had passed. Unlike a deadline this gives the same
+         * result on any machine.
+         * @param limit
+         * Nodes per search, or 0 for no limit (the default).
+         */
+        void setNodeLimit(uint64_t limit) { nodeLimit = limit; }
+
+        /**
+         * @brief
+         * Turns move ordering on or off, e.g. to compare node counts.
+         * Without it moves are searched in generation order.
+         */
+        void setMoveOrdering(bool enabled) { useOrdering = enabled; }
+
+        /**
+         * @brief
+         * Turns staged move generation on or off. Without it every move of a
+         * node is generated and scored before the first one is searched. The
+         * order is the same either way, up to ties between equal scores.
+         */
+        void setStagedGeneration(bool enabled) { useStagedGeneration = enabled; }
+
+        /**
+         * @brief
+         * Turns the quiescence search at the leaves on or off.
+         * Without it leaves are scored as they stand.
+         */
+        void setQuiescence(bool enabled) { useQuiescence = enabled; }
+
+        /**
+         * @brief
+         * Turns null-move pruning on or off. With it a node is cut off when
+         * passing the turn still holds beta in a reduced search. Never used
+         * in check, twice in a row, or when the side to move has only pawns,
+         * where passing may be better than any move (zugzwang).
+         */
+        void setNullMovePruning(bool enabled) { useNullMove = enabled; }
+
+        /**
+         * @brief
+         * Turns late-move reductions on or off. With them quiet moves ordered
+         * late are searched a ply or two shallower, and again at full depth
+         * if they turn out to raise alpha.
+         */
+        void setLateMoveReductions(bool enabled) { useLateMoveReductions = enabled; }
+
+        /**
+         * @brief
+         * Turns futility pruning on or off. With it quiet moves one or two
+         * plies from the leaves are skipped when scoreBoard plus a margin
+         * cannot reach alpha.
+         */
+        void setFutilityPruning(bool enabled) { useFutility = enabled; }
+
+        /**
+         * @brief
+         * Turns pruning of losing captures in the quiescence search on or
+         * off. With it captures that ChessBoard::exchangeValue rates below
+         * zero are skipped.
+         */
+        void setExchangePruning(bool enabled) { useExchangePruning = enabled; }
+
+        /**
+         * @return
+         * The move orderer, for its cutoff statistics.
+         */
+        MoveOrderer &getMoveOrderer() { return orderer; }
+
+        /**
+         * @return
+         * Nodes visited by the last call to search.
+         */
+        uint64_t getNodes() { return nodes; }
+
+        /**
+         * @return
+         * Moves generated by the last call to search, hash moves and killers
+         * checked for legality included.
+         */
+        uint64_t getGeneratedMoves() { return generatedMoves; }
+    };
+}
+
+#endif
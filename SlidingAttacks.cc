@@ -0,0 +1,167 @@
+#include "SlidingAttacks.hh"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(BONUSCHESS_NO_PEXT)
+#define SLIDING_ATTACKS_PEXT
+#include <immintrin.h>
+#endif
+
+using Student::SlidingAttacks;
+
+namespace
+{
+    const int Directions[2][4][2] = {
+        {{-1, 0}, {1, 0}, {0, -1}, {0, 1}},
+        {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}},
+    };
+
+    int bitCount(uint64_t x)
+    {
+        return __builtin_popcountll(x);
+    }
+}
+
+#ifdef SLIDING_ATTACKS_PEXT
+__attribute__((target("bmi2"))) size_t SlidingAttacks::pextIndex(uint64_t occupied, uint64_t mask)
+{
+    return size_t(_pext_u64(occupied, mask));
+}
+#else
+size_t SlidingAttacks::pextIndex(uint64_t, uint64_t)
+{
+    return 0;
+}
+#endif
+
+bool SlidingAttacks::usesPext()
+{
+#ifdef SLIDING_ATTACKS_PEXT
+    static const bool available = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2") != 0;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+const SlidingAttacks *SlidingAttacks::forBoard(int numRows, int numCols)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, std::unique_ptr<SlidingAttacks>> built;
+
+    if (numRows <= 0 || numCols <= 0 || numRows * numCols > 64) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = built.find({numRows, numCols});
+    if (found != built.end()) return found->second.get();
+
+    std::unique_ptr<SlidingAttacks> tables(new SlidingAttacks(numRows, numCols));
+    // An empty table means some mask was too wide to tabulate.
+    if (tables->table.empty()) tables.reset();
+    return (built[{numRows, numCols}] = std::move(tables)).get();
+}
+
+SlidingAttacks::SlidingAttacks(int R, int C)
+  : numRows(R), numCols(C), pext(usesPext())
+{
+    for (int sq = 0; sq < R * C; ++sq) {
+        if (bitCount(relevantMask(sq, false)) > MaxMaskBits || bitCount(relevantMask(sq, true)) > MaxMaskBits)
+            return;
+    }
+    fill(rook, false);
+    fill(bishop, true);
+}
+
+uint64_t SlidingAttacks::walk(int square, uint64_t occupied, bool diagonal) const
+{
+    uint64_t attacks = 0;
+    for (const int *d : Directions[diagonal]) {
+        int r = square / numCols + d[0], c = square % numCols + d[1];
+        while (r >= 0 && r < numRows && c >= 0 && c < numCols) {
+            uint64_t bit = uint64_t(1) << (r * numCols + c);
+            attacks |= bit;
+            if (occupied & bit) break;
+            r += d[0];
+            c += d[1];
+        }
+    }
+    return attacks;
+}
+
+uint64_t SlidingAttacks::relevantMask(int square, bool diagonal) const
+{
+    // The last square of a ray is attacked whether or not it is occupied.
+    uint64_t mask = 0;
+    for (const int *d : Directions[diagonal]) {
+        int r = square / numCols + d[0], c = square % numCols + d[1];
+        int nr = r + d[0], nc = c + d[1];
+        while (nr >= 0 && nr < numRows && nc >= 0 && nc < numCols) {
+            mask |= uint64_t(1) << (r * numCols + c);
+            r = nr;
+            c = nc;
+            nr += d[0];
+            nc += d[1];
+        }
+    }
+    return mask;
+}
+
+void SlidingAttacks::fill(Entry *entries, bool diagonal)
+{
+    // Fixed seed, so every run finds the same magics.
+    std::mt19937_64 rng(0x9E3779B97F4A7C15ULL + numRows * 64 + numCols);
+    std::vector<uint64_t> subsets, attacks, slots;
+    std::vector<bool> used;
+
+    for (int sq = 0; sq < numRows * numCols; ++sq) {
+        Entry &e = entries[sq];
+        e.mask = relevantMask(sq, diagonal);
+        int bits = bitCount(e.mask);
+        // A shift of 64 would be undefined; an index bit of zero is harmless.
+        if (bits == 0) bits = 1;
+        e.shift = 64 - bits;
+        e.offset = uint32_t(table.size());
+        size_t size = size_t(1) << bits;
+
+        subsets.clear();
+        attacks.clear();
+        uint64_t subset = 0;
+        do {
+            subsets.push_back(subset);
+            attacks.push_back(walk(sq, subset, diagonal));
+            subset = (subset - e.mask) & e.mask;
+        } while (subset);
+
+        table.resize(e.offset + size, 0);
+        if (pext) {
+            for (size_t i = 0; i < subsets.size(); ++i)
+                table[e.offset + pextIndex(subsets[i], e.mask)] = attacks[i];
+            continue;
+        }
+
+        // Sparse random candidates until one maps every subset without a
+        // harmful collision; subsets with equal attack sets may share a slot.
+        slots.assign(size, 0);
+        for (;;) {
+            e.magic = rng() & rng() & rng();
+            used.assign(size, false);
+            bool ok = true;
+            for (size_t i = 0; i < subsets.size() && ok; ++i) {
+                size_t idx = size_t((subsets[i] * e.magic) >> e.shift);
+                if (!used[idx]) {
+                    used[idx] = true;
+                    slots[idx] = attacks[i];
+                } else if (slots[idx] != attacks[i]) {
+                    ok = false;
+                }
+            }
+            if (ok) break;
+        }
+        for (size_t i = 0; i < size; ++i) table[e.offset + i] = slots[i];
+    }
+}
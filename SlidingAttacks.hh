@@ -0,0 +1,93 @@
+#ifndef __SLIDINGATTACKS_H__
+#define __SLIDINGATTACKS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Student
+{
+    /**
+     * @brief
+     * Rook and bishop attack sets for boards of up to 64 squares, looked up
+     * from tables instead of walking rays. Square (row, column) is bit
+     * row * numCols + column of the occupancy and attack masks.
+     * Tables are indexed with BMI2 PEXT when the CPU has it, and by magic
+     * multiplication otherwise (or when built with BONUSCHESS_NO_PEXT).
+     */
+    class SlidingAttacks
+    {
+    private:
+        struct Entry
+        {
+            // Squares whose occupancy can change the attack set: the rays
+            // without their last square.
+            uint64_t mask = 0;
+            uint64_t magic = 0;
+            int shift = 64;
+            uint32_t offset = 0;
+        };
+
+        int numRows;
+        int numCols;
+        bool pext;
+        Entry rook[64];
+        Entry bishop[64];
+        std::vector<uint64_t> table;
+
+        SlidingAttacks(int numRows, int numCols);
+        uint64_t walk(int square, uint64_t occupied, bool diagonal) const;
+        uint64_t relevantMask(int square, bool diagonal) const;
+        void fill(Entry *entries, bool diagonal);
+        static size_t pextIndex(uint64_t occupied, uint64_t mask);
+
+        size_t index(const Entry &e, uint64_t occupied) const
+        {
+            if (pext) return pextIndex(occupied, e.mask);
+            return size_t(((occupied & e.mask) * e.magic) >> e.shift);
+        }
+
+    public:
+        // Largest mask for which tables are built; 12 is the rook's on 8x8.
+        static const int MaxMaskBits = 12;
+
+        /**
+         * @return
+         * The tables for a board geometry, built on first use and shared by
+         * all boards of that size, or nullptr when the board has more than
+         * 64 squares or is too elongated for tables of reasonable size.
+         * Safe to call from several threads.
+         */
+        static const SlidingAttacks *forBoard(int numRows, int numCols);
+
+        /**
+         * @return
+         * Returns true if lookups use PEXT rather than magic multiplication.
+         */
+        static bool usesPext();
+
+        /**
+         * @return
+         * Squares a rook on the square attacks, up to and including the
+         * first occupied square in each direction.
+         */
+        uint64_t rookAttacks(int square, uint64_t occupied) const
+        {
+            const Entry &e = rook[square];
+            return table[e.offset + index(e, occupied)];
+        }
+
+        /**
+         * @return
+         * Squares a bishop on the square attacks, up to and including the
+         * first occupied square in each direction.
+         */
+        uint64_t bishopAttacks(int square, uint64_t occupied) const
+        {
+            const Entry &e = bishop[square];
+            return table[e.offset + index(e, occupied)];
+        }
+    };
+}
+
+#endif
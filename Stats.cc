@@ -0,0 +1,131 @@
+#include "Stats.hh"
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using Student::Stats;
+
+namespace
+{
+    const char *CounterNames[Stats::NumCounters] = {
+        "isValidMove",
+        "isPseudoValidMove",
+        "isSquareUnderAttack",
+        "wouldLeaveKingInCheck",
+        "scoreBoard",
+        "nodes",
+        "cacheHits",
+        "cacheMisses",
+    };
+
+    const char *TimerNames[Stats::NumTimers] = {
+        "scoreBoard",
+        "search",
+    };
+
+    std::mutex &registryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    std::vector<Stats::ThreadBlock *> &liveBlocks()
+    {
+        static std::vector<Stats::ThreadBlock *> blocks;
+        return blocks;
+    }
+
+    // Totals of threads that have exited.
+    Stats::Snapshot &retired()
+    {
+        static Stats::Snapshot totals;
+        return totals;
+    }
+
+    void addBlock(Stats::Snapshot &s, const Stats::ThreadBlock &b)
+    {
+        for (int i = 0; i < Stats::NumCounters; ++i)
+            s.counters[i] += b.counters[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < Stats::NumTimers; ++i) {
+            s.timerCalls[i] += b.timerCalls[i].load(std::memory_order_relaxed);
+            s.timerNanos[i] += b.timerNanos[i].load(std::memory_order_relaxed);
+            s.timerMaxNanos[i] = std::max(s.timerMaxNanos[i], b.timerMaxNanos[i].load(std::memory_order_relaxed));
+        }
+    }
+}
+
+Stats::ThreadBlock::ThreadBlock()
+{
+    for (auto &c : counters) c.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < NumTimers; ++i) {
+        timerCalls[i].store(0, std::memory_order_relaxed);
+        timerNanos[i].store(0, std::memory_order_relaxed);
+        timerMaxNanos[i].store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(registryMutex());
+    liveBlocks().push_back(this);
+}
+
+Stats::ThreadBlock::~ThreadBlock()
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    addBlock(retired(), *this);
+    std::vector<ThreadBlock *> &blocks = liveBlocks();
+    blocks.erase(std::remove(blocks.begin(), blocks.end(), this), blocks.end());
+}
+
+thread_local Stats::ThreadBlock Stats::local;
+
+bool Stats::isEnabled()
+{
+#ifdef BONUSCHESS_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Stats::addTime(Timer t, uint64_t nanos)
+{
+    ThreadBlock &b = local;
+    b.timerCalls[t].store(b.timerCalls[t].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    b.timerNanos[t].store(b.timerNanos[t].load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+    if (nanos > b.timerMaxNanos[t].load(std::memory_order_relaxed))
+        b.timerMaxNanos[t].store(nanos, std::memory_order_relaxed);
+}
+
+Stats::Snapshot Stats::snapshot()
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    Snapshot s = retired();
+    for (const ThreadBlock *b : liveBlocks()) addBlock(s, *b);
+    return s;
+}
+
+Stats::Snapshot Stats::Snapshot::operator-(const Snapshot &earlier) const
+{
+    Snapshot d;
+    for (int i = 0; i < NumCounters; ++i) d.counters[i] = counters[i] - earlier.counters[i];
+    for (int i = 0; i < NumTimers; ++i) {
+        d.timerCalls[i] = timerCalls[i] - earlier.timerCalls[i];
+        d.timerNanos[i] = timerNanos[i] - earlier.timerNanos[i];
+        d.timerMaxNanos[i] = timerMaxNanos[i];
+    }
+    return d;
+}
+
+std::string Stats::Snapshot::toJson() const
+{
+    std::ostringstream out;
+    out << "{\"counters\":{";
+    for (int i = 0; i < NumCounters; ++i)
+        out << (i ? "," : "") << "\"" << CounterNames[i] << "\":" << counters[i];
+    out << "},\"timers\":{";
+    for (int i = 0; i < NumTimers; ++i) {
+        out << (i ? "," : "") << "\"" << TimerNames[i] << "\":{\"calls\":" << timerCalls[i]
+            << ",\"totalNs\":" << timerNanos[i] << ",\"maxNs\":" << timerMaxNanos[i] << "}";
+    }
+    out << "}}";
+    return out.str();
+}
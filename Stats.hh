@@ -0,0 +1,135 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * Hot-path counters and timers, compiled in only when BONUSCHESS_STATS is
+ * defined. Without it STATS_COUNT and STATS_TIME expand to nothing and
+ * snapshots read all zeros.
+ */
+#ifdef BONUSCHESS_STATS
+#define STATS_COUNT(counter) ::Student::Stats::count(::Student::Stats::counter)
+#define STATS_TIME_CONCAT(a, b) a##b
+#define STATS_TIME_NAME(line) STATS_TIME_CONCAT(statsTimer, line)
+#define STATS_TIME(timer) ::Student::Stats::ScopedTimer STATS_TIME_NAME(__LINE__)(::Student::Stats::timer)
+#else
+#define STATS_COUNT(counter) ((void)0)
+#define STATS_TIME(timer) ((void)0)
+#endif
+
+namespace Student
+{
+    /**
+     * @brief
+     * Process-wide statistics. Every thread accumulates into a block of its
+     * own, so counting never contends; snapshot() adds up the blocks of live
+     * threads and those of threads that have exited.
+     */
+    class Stats
+    {
+    public:
+        enum Counter
+        {
+            IsValidMoveCalls,
+            IsPseudoValidMoveCalls,
+            IsSquareUnderAttackCalls,
+            WouldLeaveKingInCheckCalls,
+            ScoreBoardCalls,
+            NodesSearched,
+            CacheHits,
+            CacheMisses,
+            NumCounters,
+        };
+
+        enum Timer
+        {
+            ScoreBoardTime,
+            SearchTime,
+            NumTimers,
+        };
+
+        /**
+         * @brief
+         * Totals at one point in time. Subtract two snapshots to get the
+         * activity in between.
+         */
+        struct Snapshot
+        {
+            uint64_t counters[NumCounters] = {};
+            uint64_t timerCalls[NumTimers] = {};
+            uint64_t timerNanos[NumTimers] = {};
+            // Longest single timed call since the process started.
+            uint64_t timerMaxNanos[NumTimers] = {};
+
+            Snapshot operator-(const Snapshot &earlier) const;
+
+            /**
+             * @return
+             * The snapshot as a JSON object.
+             */
+            std::string toJson() const;
+        };
+
+        // One thread's counters. Only the owning thread writes them, so
+        // plain load/store pairs suffice; the atomics let snapshot() read
+        // them while they change.
+        struct ThreadBlock
+        {
+            std::atomic<uint64_t> counters[NumCounters];
+            std::atomic<uint64_t> timerCalls[NumTimers];
+            std::atomic<uint64_t> timerNanos[NumTimers];
+            std::atomic<uint64_t> timerMaxNanos[NumTimers];
+
+            ThreadBlock();
+            ~ThreadBlock();
+        };
+
+        /**
+         * @return
+         * Returns true if statistics were compiled in.
+         */
+        static bool isEnabled();
+
+        /**
+         * @return
+         * Current totals over all threads.
+         */
+        static Snapshot snapshot();
+
+        // The calling thread's block, registered on its first use.
+        static thread_local ThreadBlock local;
+
+        static void count(Counter c)
+        {
+            std::atomic<uint64_t> &v = local.counters[c];
+            v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        static void addTime(Timer t, uint64_t nanos);
+
+        /**
+         * @brief
+         * Times the enclosing scope.
+         */
+        class ScopedTimer
+        {
+        private:
+            Timer timer;
+            std::chrono::steady_clock::time_point begin;
+
+        public:
+            explicit ScopedTimer(Timer t) : timer(t), begin(std::chrono::steady_clock::now()) {}
+            ~ScopedTimer()
+            {
+                auto elapsed = std::chrono::steady_clock::now() - begin;
+                addTime(timer, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            }
+        };
+    };
+}
+
+#endif
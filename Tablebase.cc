@@ -0,0 +1,525 @@
+#include "Tablebase.hh"
+#include "ChessBoard.hh"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <thread>
+
+using Student::Tablebase;
+using Student::TablebaseResult;
+using Student::ChessBoard;
+using Student::ChessPiece;
+
+namespace
+{
+    // Stored values: 0 = draw, 1 = illegal position, otherwise distance to mate + 2.
+    // An even distance means the side to move gets mated, an odd one that it mates.
+    const uint8_t DrawValue = 0;
+    const uint8_t IllegalValue = 1;
+    const uint8_t MateOffset = 2;
+    const int MaxDistance = TablebaseResult::MaxDistance;
+    // Only used while solving: a position proven drawn (stalemate) that needs no more passes.
+    // Unsolved positions are 0 until the last pass, after which they are draws.
+    const uint8_t ResolvedDraw = 255;
+
+    const uint64_t BlockSize = 4096;
+    const uint32_t FileVersion = 1;
+    const char FileMagic[4] = {'B', 'C', 'T', 'B'};
+    const int MaxTablePieces = 6;
+
+    // Canonical piece order inside a material key.
+    const char PieceLetters[] = "KQRBNP";
+    const Type PieceOrder[] = {King, Queen, Rook, Bishop, Knight, Pawn};
+
+    int typeOrder(Type t)
+    {
+        for (int i = 0; i < 6; ++i)
+            if (PieceOrder[i] == t) return i;
+        return 6;
+    }
+
+    template <typename T>
+    void writeValue(std::ostream &out, const T &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(std::istream &in, T &value)
+    {
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    // Runs work(board, placed, index) for every index in [0, total).
+    // Indices are handed out in chunks; every thread owns a board of its own
+    // and the list of squares it currently has pieces on.
+    template <typename Work>
+    void parallelFor(int numRows, int numCols, uint64_t total, unsigned numThreads, Work work)
+    {
+        const uint64_t ChunkSize = 1024;
+        std::atomic<uint64_t> nextChunk(0);
+        auto worker = [&]() {
+            ChessBoard board(numRows, numCols);
+            std::vector<int> placed;
+            for (;;) {
+                uint64_t begin = nextChunk.fetch_add(ChunkSize);
+                if (begin >= total) break;
+                uint64_t end = std::min(total, begin + ChunkSize);
+                for (uint64_t index = begin; index < end; ++index) work(board, placed, index);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < numThreads; ++i) threads.emplace_back(worker);
+        worker();
+        for (std::thread &t : threads) t.join();
+    }
+}
+
+uint8_t Tablebase::Table::valueAt(uint64_t index) const
+{
+    uint64_t block = index / BlockSize;
+    uint64_t offset = index % BlockSize;
+    // Blocks are (run length - 1, value) pairs.
+    for (uint64_t pos = blockOffsets.at(block); pos + 1 < data.size(); pos += 2) {
+        uint64_t run = uint64_t(data[pos]) + 1;
+        if (offset < run) return data[pos + 1];
+        offset -= run;
+    }
+    return IllegalValue;
+}
+
+Tablebase::Tablebase(int numRow, int numCol)
+{
+    numRows = numRow;
+    numCols = numCol;
+}
+
+// ----------------------------------------------------------------------------
+// MATERIAL KEYS
+// ----------------------------------------------------------------------------
+
+bool Tablebase::parseMaterial(const std::string &material, std::vector<std::pair<Color, Type>> &pieces)
+{
+    pieces.clear();
+    size_t split = material.find('v');
+    if (split == std::string::npos) return false;
+
+    int kings[2] = {0, 0};
+    for (size_t i = 0; i < material.size(); ++i) {
+        if (i == split) continue;
+        Color c = (i < split) ? White : Black;
+        const char *letter = std::find(PieceLetters, PieceLetters + 6, material[i]);
+        if (letter == PieceLetters + 6) return false;
+        Type t = PieceOrder[letter - PieceLetters];
+        if (t == King) kings[c]++;
+        pieces.push_back({c, t});
+    }
+    if (kings[White] != 1 || kings[Black] != 1) return false;
+    if (pieces.size() > size_t(MaxTablePieces)) return false;
+
+    std::stable_sort(pieces.begin(), pieces.end(), [](const std::pair<Color, Type> &a, const std::pair<Color, Type> &b) {
+        if (a.first != b.first) return a.first == White;
+        return typeOrder(a.second) < typeOrder(b.second);
+    });
+    return true;
+}
+
+std::string Tablebase::materialKey(const std::vector<std::pair<Color, Type>> &pieces)
+{
+    std::string side[2];
+    for (int order = 0; order < 6; ++order) {
+        for (const std::pair<Color, Type> &p : pieces) {
+            if (p.second == PieceOrder[order]) side[p.first] += PieceLetters[order];
+        }
+    }
+    return side[White] + "v" + side[Black];
+}
+
+std::string Tablebase::swapColors(const std::string &key)
+{
+    size_t split = key.find('v');
+    return key.substr(split + 1) + "v" + key.substr(0, split);
+}
+
+std::vector<std::string> Tablebase::subMaterials(const std::vector<std::pair<Color, Type>> &pieces)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (pieces[i].second == King) continue;
+        std::vector<std::pair<Color, Type>> captured = pieces;
+        captured.erase(captured.begin() + i);
+        keys.push_back(materialKey(captured));
+        if (pieces[i].second == Pawn) {
+            std::vector<std::pair<Color, Type>> promoted = pieces;
+            promoted[i].second = Queen;
+            keys.push_back(materialKey(promoted));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+std::string Tablebase::tablePath(const std::string &directory, const std::string &key)
+{
+    return directory + "/" + key + "-" + std::to_string(numRows) + "x" + std::to_string(numCols) + ".bctb";
+}
+
+bool Tablebase::hasTable(const std::string &key)
+{
+    return key == "KvK" || tables.count(key) || tables.count(swapColors(key));
+}
+
+// ----------------------------------------------------------------------------
+// LOADING AND PROBING
+// ----------------------------------------------------------------------------
+
+bool Tablebase::loadTable(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[4];
+    uint32_t version = 0, count = 0, maxDistance = 0;
+    int32_t rows = 0, cols = 0;
+    uint64_t blockSize = 0;
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, FileMagic)) return false;
+    if (!readValue(in, version) || version != FileVersion) return false;
+    if (!readValue(in, rows) || !readValue(in, cols) || rows != numRows || cols != numCols) return false;
+    if (!readValue(in, count) || count > uint32_t(MaxTablePieces)) return false;
+
+    Table table;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t c = 0, t = 0;
+        if (!readValue(in, c) || !readValue(in, t)) return false;
+        table.pieces.push_back({Color(c), Type(t)});
+    }
+    if (!readValue(in, table.numPositions) || !readValue(in, maxDistance)) return false;
+    if (!readValue(in, blockSize) || blockSize != BlockSize) return false;
+    table.maxDistance = int(maxDistance);
+
+    uint64_t numBlocks = (table.numPositions + BlockSize - 1) / BlockSize;
+    for (uint64_t b = 0; b < numBlocks; ++b) {
+        uint32_t length = 0;
+        if (!readValue(in, length)) return false;
+        table.blockOffsets.push_back(table.data.size());
+        table.data.resize(table.data.size() + length);
+        if (!in.read(reinterpret_cast<char *>(table.data.data() + table.blockOffsets.back()), length)) return false;
+    }
+
+    maxPieces = std::max(maxPieces, int(count));
+    tables[materialKey(table.pieces)] = std::move(table);
+    return true;
+}
+
+bool Tablebase::load(const std::string &directory, const std::string &material)
+{
+    std::vector<std::pair<Color, Type>> pieces;
+    if (!parseMaterial(material, pieces)) return false;
+
+    std::string key = materialKey(pieces);
+    if (!hasTable(key) && !loadTable(tablePath(directory, key)) &&
+        !loadTable(tablePath(directory, swapColors(key)))) {
+        return false;
+    }
+    for (const std::string &sub : subMaterials(pieces)) {
+        if (!load(directory, sub)) return false;
+    }
+    return true;
+}
+
+bool Tablebase::lookup(std::vector<Placement> pieces, Color sideToMove, uint8_t &value) const
+{
+    bool onlyKings = true;
+    for (const Placement &p : pieces)
+        if (p.type != King) onlyKings = false;
+    if (onlyKings) {
+        value = DrawValue;
+        return true;
+    }
+
+    auto byMaterial = [](const Placement &a, const Placement &b) {
+        if (a.color != b.color) return a.color == White;
+        if (a.type != b.type) return typeOrder(a.type) < typeOrder(b.type);
+        return a.square < b.square;
+    };
+    std::sort(pieces.begin(), pieces.end(), byMaterial);
+
+    std::vector<std::pair<Color, Type>> material;
+    for (const Placement &p : pieces) material.push_back({p.color, p.type});
+    std::string key = materialKey(material);
+
+    auto found = tables.find(key);
+    if (found == tables.end()) {
+        // Use the table solved with colours reversed: mirror the rows, since
+        // pawns of the other colour run the other way.
+        found = tables.find(swapColors(key));
+        if (found == tables.end()) return false;
+        for (Placement &p : pieces) {
+            int row = p.square / numCols;
+            p.square = (numRows - 1 - row) * numCols + p.square % numCols;
+            p.color = (p.color == White) ? Black : White;
+        }
+        sideToMove = (sideToMove == White) ? Black : White;
+        std::sort(pieces.begin(), pieces.end(), byMaterial);
+    }
+
+    const Table &table = found->second;
+    if (table.pieces.size() != pieces.size()) return false;
+    uint64_t index = 0;
+    for (const Placement &p : pieces) index = index * uint64_t(numRows * numCols) + p.square;
+    index = index * 2 + (sideToMove == White ? 0 : 1);
+    value = table.valueAt(index);
+    return true;
+}
+
+bool Tablebase::probe(ChessBoard &board, Color sideToMove, TablebaseResult &result)
+{
+    if (maxPieces == 0 || board.getNumRows() != numRows || board.getNumCols() != numCols) return false;
+    if (board.getEnPassantTarget().first != -1) return false;
+
+    std::vector<Placement> pieces;
+    for (int r = 0; r < numRows; ++r) {
+        for (int c = 0; c < numCols; ++c) {
+            ChessPiece *p = board.getPiece(r, c);
+            if (!p) continue;
+            if (int(pieces.size()) == maxPieces) return false;
+
+            // Tables know nothing of castling.
+            if (p->getType() == King && !p->getHasMoved()) {
+                for (int rookCol : {0, numCols - 1}) {
+                    ChessPiece *rook = board.getPiece(r, rookCol);
+                    if (rook && rook->getType() == Rook && rook->getColor() == p->getColor() && !rook->getHasMoved())
+                        return false;
+                }
+            }
+            pieces.push_back({p->getColor(), p->getType(), r * numCols + c});
+        }
+    }
+
+    uint8_t value = IllegalValue;
+    if (!lookup(pieces, sideToMove, value) || value == IllegalValue) return false;
+
+    if (value == DrawValue) {
+        result.outcome = TablebaseResult::Draw;
+        result.distanceToMate = 0;
+    } else {
+        result.distanceToMate = value - MateOffset;
+        result.outcome = (result.distanceToMate % 2 == 0) ? TablebaseResult::Loss : TablebaseResult::Win;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// GENERATION
+// ----------------------------------------------------------------------------
+
+bool Tablebase::generate(int numRow, int numCol, const std::string &material,
+                         const std::string &directory, unsigned numThreads)
+{
+    std::vector<std::pair<Color, Type>> pieces;
+    if (!parseMaterial(material, pieces)) return false;
+    // With pawns on both sides a double step can be taken en passant, which
+    // the tables, indexed by placement alone, have no room for.
+    bool whitePawn = false, blackPawn = false;
+    for (const auto &piece : pieces) {
+        if (piece.second != Pawn) continue;
+        if (piece.first == White) whitePawn = true;
+        else blackPawn = true;
+    }
+    if (whitePawn && blackPawn) return false;
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    Tablebase tablebase(numRow, numCol);
+    if (!tablebase.prepareSubTables(pieces, directory, numThreads)) return false;
+    return tablebase.build(pieces, directory, numThreads);
+}
+
+bool Tablebase::prepareSubTables(const std::vector<std::pair<Color, Type>> &pieces,
+                                 const std::string &directory, unsigned numThreads)
+{
+    for (const std::string &sub : subMaterials(pieces)) {
+        if (hasTable(sub) || load(directory, sub)) continue;
+        if (!generate(numRows, numCols, sub, directory, numThreads)) return false;
+        if (!load(directory, sub)) return false;
+    }
+    return true;
+}
+
+uint8_t Tablebase::analyse(ChessBoard &board, std::vector<int> &placed,
+                           const std::vector<std::pair<Color, Type>> &pieces,
+                           const std::atomic<uint8_t> *values, uint64_t index, int pass)
+{
+    const int numSquares = numRows * numCols;
+    const int count = int(pieces.size());
+    Color toMove = (index % 2 == 0) ? White : Black;
+    Color opponent = (toMove == White) ? Black : White;
+
+    int squares[MaxTablePieces];
+    uint64_t rest = index / 2;
+    for (int i = count - 1; i >= 0; --i) {
+        squares[i] = int(rest % numSquares);
+        rest /= numSquares;
+    }
+
+    if (pass == 0) {
+        for (int i = 0; i < count; ++i) {
+            for (int j = i + 1; j < count; ++j)
+                if (squares[i] == squares[j]) return IllegalValue;
+            int row = squares[i] / numCols;
+            if (pieces[i].second == Pawn && (row == 0 || row == numRows - 1)) return IllegalValue;
+        }
+    }
+
+    // Both sides to move share a placement, so only rebuild the board when it changed.
+    if (placed.size() != size_t(count) || !std::equal(placed.begin(), placed.end(), squares)) {
+        for (int sq : placed) board.removeChessPiece(sq / numCols, sq % numCols);
+        placed.assign(squares, squares + count);
+        for (int i = 0; i < count; ++i) {
+            int row = squares[i] / numCols, col = squares[i] % numCols;
+            board.createChessPiece(pieces[i].first, pieces[i].second, row, col);
+            board.getPiece(row, col)->markAsMoved();
+        }
+    }
+
+    int ownKing = -1, enemyKing = -1;
+    for (int i = 0; i < count; ++i) {
+        if (pieces[i].second != King) continue;
+        if (pieces[i].first == toMove) ownKing = squares[i];
+        else enemyKing = squares[i];
+    }
+    if (pass == 0 && board.isPieceUnderThreat(enemyKing / numCols, enemyKing % numCols)) return IllegalValue;
+
+    bool anyMove = false;
+    bool allWins = true;
+    int maxWin = -1;
+    std::vector<Placement> next;
+    for (int j = 0; j < count; ++j) {
+        if (pieces[j].first != toMove) continue;
+        int fromRow = squares[j] / numCols, fromCol = squares[j] % numCols;
+
+        for (int to = 0; to < numSquares; ++to) {
+            int toRow = to / numCols, toCol = to % numCols;
+            if (!board.isValidMove(fromRow, fromCol, toRow, toCol)) continue;
+            anyMove = true;
+            // The first pass only looks for mates and stalemates.
+            if (pass == 0) return 0;
+
+            int captured = -1;
+            for (int m = 0; m < count; ++m)
+                if (m != j && squares[m] == to) captured = m;
+            bool promotes = (pieces[j].second == Pawn && (toRow == 0 || toRow == numRows - 1));
+
+            uint8_t child = 0;
+            if (captured < 0 && !promotes) {
+                uint64_t childIndex = 0;
+                for (int i = 0; i < count; ++i) childIndex = childIndex * numSquares + (i == j ? to : squares[i]);
+                child = values[childIndex * 2 + (opponent == White ? 0 : 1)].load(std::memory_order_relaxed);
+            } else {
+                // The move leaves this table; the result comes from an already solved one.
+                next.clear();
+                for (int i = 0; i < count; ++i) {
+                    if (i == captured) continue;
+                    Type t = (i == j && promotes) ? Queen : pieces[i].second;
+                    next.push_back({pieces[i].first, t, i == j ? to : squares[i]});
+                }
+                if (!lookup(next, opponent, child)) child = 0;
+            }
+
+            // Children only count once their distance is known to this pass.
+            if (child >= MateOffset && child != ResolvedDraw && child - MateOffset < pass) {
+                int distance = child - MateOffset;
+                if (distance % 2 == 0) return uint8_t(MateOffset + distance + 1);
+                maxWin = std::max(maxWin, distance);
+            } else {
+                allWins = false;
+            }
+        }
+    }
+
+    if (!anyMove) {
+        bool inCheck = board.isPieceUnderThreat(ownKing / numCols, ownKing % numCols);
+        return inCheck ? MateOffset : ResolvedDraw;
+    }
+    if (allWins && maxWin + 1 <= MaxDistance) return uint8_t(MateOffset + maxWin + 1);
+    return 0;
+}
+
+bool Tablebase::build(const std::vector<std::pair<Color, Type>> &pieces,
+                      const std::string &directory, unsigned numThreads)
+{
+    const uint64_t numSquares = uint64_t(numRows) * numCols;
+    uint64_t total = 2;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (total > std::numeric_limits<uint64_t>::max() / numSquares) return false;
+        total *= numSquares;
+    }
+
+    int maxExit = 0;
+    for (const auto &entry : tables) maxExit = std::max(maxExit, entry.second.maxDistance);
+
+    // Pass n settles every position that is mate in exactly n plies, so
+    // values are written in place: a position settled during the pass is n
+    // plies from mate, which analyse does not count before the next pass,
+    // and pass 0 reads no children at all. One array is all the memory the
+    // passes need, but it is the whole table uncompressed; only the output
+    // is streamed.
+    std::unique_ptr<std::atomic<uint8_t>[]> values(new (std::nothrow) std::atomic<uint8_t>[total]);
+    if (!values) return false;
+    for (uint64_t i = 0; i < total; ++i) values[i].store(0, std::memory_order_relaxed);
+    for (int pass = 0; pass <= MaxDistance; ++pass) {
+        std::atomic<uint64_t> changed(0);
+        parallelFor(numRows, numCols, total, numThreads, [&](ChessBoard &board, std::vector<int> &placed, uint64_t index) {
+            if (values[index].load(std::memory_order_relaxed) != 0) return;
+            uint8_t value = analyse(board, placed, pieces, values.get(), index, pass);
+            if (value != 0) {
+                values[index].store(value, std::memory_order_relaxed);
+                changed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        if (pass > maxExit + 1 && changed.load() == 0) break;
+    }
+
+    uint32_t maxDistance = 0;
+    for (uint64_t i = 0; i < total; ++i) {
+        uint8_t v = values[i].load(std::memory_order_relaxed);
+        if (v == ResolvedDraw) values[i].store(DrawValue, std::memory_order_relaxed);
+        else if (v >= MateOffset) maxDistance = std::max(maxDistance, uint32_t(v - MateOffset));
+    }
+
+    std::ofstream out(tablePath(directory, materialKey(pieces)), std::ios::binary);
+    if (!out) return false;
+    out.write(FileMagic, 4);
+    writeValue(out, FileVersion);
+    writeValue(out, int32_t(numRows));
+    writeValue(out, int32_t(numCols));
+    writeValue(out, uint32_t(pieces.size()));
+    for (const std::pair<Color, Type> &p : pieces) {
+        writeValue(out, uint8_t(p.first));
+        writeValue(out, uint8_t(p.second));
+    }
+    writeValue(out, total);
+    writeValue(out, maxDistance);
+    writeValue(out, BlockSize);
+
+    // Blocks are encoded and written one at a time.
+    std::vector<uint8_t> block;
+    for (uint64_t begin = 0; begin < total; begin += BlockSize) {
+        uint64_t end = std::min(total, begin + BlockSize);
+        block.clear();
+        for (uint64_t i = begin; i < end;) {
+            uint64_t run = 1;
+            uint8_t value = values[i].load(std::memory_order_relaxed);
+            while (i + run < end && run < 256 && values[i + run].load(std::memory_order_relaxed) == value) ++run;
+            block.push_back(uint8_t(run - 1));
+            block.push_back(value);
+            i += run;
+        }
+        writeValue(out, uint32_t(block.size()));
+        out.write(reinterpret_cast<const char *>(block.data()), block.size());
+    }
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,170 @@
+#ifndef __TABLEBASE_H__
+#define __TABLEBASE_H__
+
+#include "Chess.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * Outcome of a tablebase probe, seen from the side to move.
+     */
+    struct TablebaseResult
+    {
+        enum Outcome
+        {
+            Loss = -1,
+            Draw = 0,
+            Win = 1,
+        };
+        Outcome outcome = Draw;
+        // Plies until mate for won or lost positions, 0 for draws.
+        int distanceToMate = 0;
+        // Longest distance to mate a table can hold.
+        static const int MaxDistance = 252;
+        // Score of a won position mated on the spot; outweighs any material balance.
+        static constexpr float MateScore = 1000.0f;
+
+        /**
+         * @return
+         * Score of the result for the side to move. Quicker mates score higher.
+         */
+        float score() const { return int(outcome) * (MateScore - distanceToMate); }
+    };
+
+    /**
+     * @brief
+     * Endgame tablebases for a fixed board geometry.
+     * A table covers one material set such as "KQvK" (white pieces before
+     * the 'v', black pieces after) and stores win/draw/loss together with
+     * the distance to mate for every placement and side to move.
+     * Tables are solved by retrograde analysis and stored run-length
+     * encoded on disk, one file per material set.
+     *
+     * Positions are solved without castling rights or en passant targets,
+     * so probing refuses positions that still have either.
+     */
+    class Tablebase
+    {
+    private:
+        struct Placement
+        {
+            Color color;
+            Type type;
+            int square;
+        };
+
+        struct Table
+        {
+            std::vector<std::pair<Color, Type>> pieces;
+            uint64_t numPositions = 0;
+            int maxDistance = 0;
+            // Start of every compressed block within data.
+            std::vector<uint64_t> blockOffsets;
+            std::vector<uint8_t> data;
+            uint8_t valueAt(uint64_t index) const;
+        };
+
+        int numRows = 0;
+        int numCols = 0;
+        int maxPieces = 0;
+        std::map<std::string, Table> tables;
+
+        static bool parseMaterial(const std::string &material, std::vector<std::pair<Color, Type>> &pieces);
+        static std::string materialKey(const std::vector<std::pair<Color, Type>> &pieces);
+        static std::string swapColors(const std::string &key);
+        static std::vector<std::string> subMaterials(const std::vector<std::pair<Color, Type>> &pieces);
+        std::string tablePath(const std::string &directory, const std::string &key);
+
+        bool loadTable(const std::string &path);
+        bool hasTable(const std::string &key);
+        bool prepareSubTables(const std::vector<std::pair<Color, Type>> &pieces,
+                              const std::string &directory, unsigned numThreads);
+        bool build(const std::vector<std::pair<Color, Type>> &pieces,
+                   const std::string &directory, unsigned numThreads);
+        uint8_t analyse(ChessBoard &board, std::vector<int> &placed,
+                        const std::vector<std::pair<Color, Type>> &pieces,
+                        const std::atomic<uint8_t> *values, uint64_t index, int pass);
+        bool lookup(std::vector<Placement> pieces, Color sideToMove, uint8_t &value) const;
+
+    public:
+        /**
+         * @brief
+         * Creates an empty tablebase for boards of the given size.
+         * @param numRow
+         * Number of rows of the chess board.
+         * @param numCol
+         * Number of columns of the chess board.
+         */
+        Tablebase(int numRow, int numCol);
+
+        /**
+         * @brief
+         * Solves a material set and writes its table to disk.
+         * Tables for every material set reachable by a capture or promotion are
+         * loaded from the same directory, or generated first when missing.
+         * Work is split across threads, each with a board of its own, and the
+         * compressed table is streamed to the file block by block. Solving
+         * itself is done in memory, one byte per position of the table being
+         * built, 2 * (numRow * numCol)^pieces, besides the compressed tables
+         * it depends on: 34 MB for four pieces on 8x8, 2.1 GB for five, and
+         * 20 GB for five on 10x10. Generation fails if that cannot be
+         * allocated. Material with pawns of both colours is refused, since
+         * the tables have no way to tell when en passant is possible.
+         * @param numRow
+         * Number of rows of the chess board.
+         * @param numCol
+         * Number of columns of the chess board.
+         * @param material
+         * Material set to solve, e.g. "KRvK".
+         * @param directory
+         * Directory the table files are read from and written to.
+         * @param numThreads
+         * Number of worker threads, 0 to use every core.
+         * @return
+         * Returns true if the table (and all tables it depends on) was written,
+         * false for an unknown or unsupported material set.
+         */
+        static bool generate(int numRow, int numCol, const std::string &material,
+                             const std::string &directory, unsigned numThreads = 0);
+
+        /**
+         * @brief
+         * Loads the table for a material set along with every table it depends on.
+         * A table solved with colours reversed ("KvKQ" for "KQvK") is used as well.
+         * @return
+         * Returns true if all needed tables were found and read.
+         */
+        bool load(const std::string &directory, const std::string &material);
+
+        /**
+         * @brief
+         * Looks up a position in the loaded tables.
+         * @param board
+         * The board holding the position.
+         * @param sideToMove
+         * The colour to move in the position.
+         * @param result
+         * Filled with the outcome when the probe succeeds.
+         * @return
+         * Returns true if the position is covered by a loaded table.
+         */
+        bool probe(ChessBoard &board, Color sideToMove, TablebaseResult &result);
+
+        /**
+         * @return
+         * Largest number of pieces (kings included) of any loaded table.
+         */
+        int getMaxPieces() { return maxPieces; }
+    };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "ThreadPool.hh"
+#include "ChessBoard.hh"
+#include <algorithm>
+#include <chrono>
+
+using Student::ThreadPool;
+using Student::ChessBoard;
+
+namespace
+{
+    // The pool the current thread is working for: set for a pool's own
+    // threads and, during run, for its caller.
+    thread_local const ThreadPool *currentPool = nullptr;
+}
+
+ThreadPool::ThreadPool(unsigned numThreads)
+{
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < numThreads; ++i) queues.emplace_back(new Queue);
+    for (unsigned i = 1; i < numThreads; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, size_t(i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        quitting = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : workers) t.join();
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)> &work)
+{
+    if (count == 0) return;
+    // A task of this pool calling run would wait on runMutex for its own
+    // batch, so the nested batch runs on the calling thread.
+    if (currentPool == this) {
+        for (size_t i = 0; i < count; ++i) work(i);
+        return;
+    }
+    std::lock_guard<std::mutex> runLock(runMutex);
+    const ThreadPool *outerPool = currentPool;
+    currentPool = this;
+
+    // Set before any task is queued: a thread still looking for work from
+    // the previous batch may pick one up right away.
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        task = &work;
+        remaining = count;
+        ++batch;
+    }
+    // Every thread starts with a contiguous share.
+    size_t numQueues = queues.size();
+    for (size_t q = 0; q < numQueues; ++q) {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        for (size_t i = count * q / numQueues; i < count * (q + 1) / numQueues; ++i) queues[q]->tasks.push_back(i);
+    }
+    wake.notify_all();
+
+    drain(0);
+    std::unique_lock<std::mutex> lock(stateMutex);
+    finished.wait(lock, [this]() { return remaining == 0; });
+    currentPool = outerPool;
+}
+
+void ThreadPool::workerLoop(size_t self)
+{
+    currentPool = this;
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [&]() { return quitting || batch != seen; });
+            if (quitting) return;
+            seen = batch;
+        }
+        drain(self);
+    }
+}
+
+void ThreadPool::drain(size_t self)
+{
+    size_t index;
+    while (takeTask(self, index)) {
+        (*task)(index);
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--remaining == 0) finished.notify_all();
+    }
+}
+
+bool ThreadPool::takeTask(size_t self, size_t &index)
+{
+    {
+        Queue &own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            index = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    // Steal the oldest task of the next thread that has any.
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue &other = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            index = other.tasks.front();
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<double> Student::measureParallelSpeedup(ChessBoard &board, unsigned maxThreads, int rounds)
+{
+    std::vector<double> speedups;
+    if (rounds <= 0) return speedups;
+
+    volatile float sink = 0.0f;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) sink = sink + board.getHighestNextScore();
+    std::chrono::duration<double> serial = std::chrono::steady_clock::now() - begin;
+
+    for (unsigned numThreads = 1; numThreads <= maxThreads; ++numThreads) {
+        ThreadPool pool(numThreads);
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i) sink = sink + board.getHighestNextScoreParallel(pool);
+        std::chrono::duration<double> parallel = std::chrono::steady_clock::now() - begin;
+        speedups.push_back(parallel.count() > 0 ? serial.count() / parallel.count() : 0.0);
+    }
+    return speedups;
+}
@@ -0,0 +1,97 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+
+    /**
+     * @brief
+     * A fixed set of threads that run batches of independent tasks. Each
+     * thread has a queue of its own that it works through from the back;
+     * once it runs dry it steals from the front of the others' queues, so
+     * uneven tasks still keep every thread busy. The thread calling run
+     * takes part as one of the threads.
+     */
+    class ThreadPool
+    {
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<size_t> tasks;
+        };
+
+        // One queue per thread, the caller's first.
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        // Serialises calls to run.
+        std::mutex runMutex;
+
+        std::mutex stateMutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        // Bumped by every run so sleeping workers can tell a new batch.
+        size_t batch = 0;
+        size_t remaining = 0;
+        bool quitting = false;
+        const std::function<void(size_t)> *task = nullptr;
+
+        void workerLoop(size_t self);
+        // Runs queued tasks until none are left anywhere.
+        void drain(size_t self);
+        bool takeTask(size_t self, size_t &index);
+
+    public:
+        /**
+         * @brief
+         * Starts the threads.
+         * @param numThreads
+         * Number of threads, the caller of run included; 0 for one per core.
+         */
+        explicit ThreadPool(unsigned numThreads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * @return
+         * Number of threads, the caller of run included.
+         */
+        unsigned getNumThreads() { return unsigned(queues.size()); }
+
+        /**
+         * @brief
+         * Calls work(i) once for every i in [0, count), spread over the
+         * threads, and returns once all calls have returned. Calls from
+         * several threads at once take turns; a call from within one of
+         * this pool's own tasks runs its batch inline on the calling thread.
+         */
+        void run(size_t count, const std::function<void(size_t)> &work);
+    };
+
+    /**
+     * @brief
+     * Times ChessBoard::getHighestNextScoreParallel against
+     * getHighestNextScore on a board's current position, with pools of 1 to
+     * maxThreads threads.
+     * @param rounds
+     * Number of calls timed per variant.
+     * @return
+     * Speedup over the serial version per thread count, starting with one
+     * thread.
+     */
+    std::vector<double> measureParallelSpeedup(ChessBoard &board, unsigned maxThreads, int rounds = 10);
+}
+
+#endif
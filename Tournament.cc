@@ -0,0 +1,169 @@
+#include "Tournament.hh"
+#include "ChessBoard.hh"
+#include "Search.hh"
+#include "ThreadPool.hh"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using Student::Tournament;
+using Student::TournamentResult;
+using Student::GameRecord;
+using Student::EngineConfig;
+using Student::ChessBoard;
+using Student::Search;
+using Student::SearchResult;
+using Student::ThreadPool;
+using Student::Move;
+
+namespace
+{
+    // Tries at an opening that does not end the game before it starts.
+    const int OpeningAttempts = 16;
+    // Scores of 0 and 1 have no finite Elo.
+    const double ScoreClamp = 0.001;
+    // Standard errors either side of the score for a 95% interval.
+    const double Confidence = 1.96;
+}
+
+Tournament::Tournament(ChessBoard &s, const EngineConfig &first, const EngineConfig &second,
+                       const TournamentSettings &ts)
+  : start(s), settings(ts)
+{
+    engines[0] = first;
+    engines[1] = second;
+    // Every game's boards are copies of the start position, so one copy
+    // tells whether the networks fit all of them.
+    std::unique_ptr<ChessBoard> board = start.clone();
+    for (const EngineConfig &engine : engines)
+        if (!board->setNeuralNetwork(engine.network)) valid = false;
+}
+
+void Tournament::configure(Search &search, const EngineConfig &config)
+{
+    search.setMoveOrdering(config.moveOrdering);
+    search.setStagedGeneration(config.stagedGeneration);
+    search.setQuiescence(config.quiescence);
+    search.setNullMovePruning(config.nullMovePruning);
+    search.setLateMoveReductions(config.lateMoveReductions);
+    search.setFutilityPruning(config.futilityPruning);
+    search.setExchangePruning(config.exchangePruning);
+}
+
+std::unique_ptr<ChessBoard> Tournament::playOpening(int opening)
+{
+    std::seed_seq seq{settings.seed, uint32_t(opening)};
+    std::mt19937 rng(seq);
+    std::unique_ptr<ChessBoard> board;
+    for (int attempt = 0; attempt < OpeningAttempts; ++attempt) {
+        board = start.clone();
+        for (int ply = 0; ply < settings.openingPlies && board->getGameStatus() == InProgress; ++ply) {
+            const std::vector<Move> &moves = board->getAllLegalMoves();
+            const Move m = moves[rng() % moves.size()];
+            board->movePiece(m.fromRow, m.fromColumn, m.toRow, m.toColumn);
+        }
+        if (board->getGameStatus() == InProgress) break;
+    }
+    return board;
+}
+
+GameRecord Tournament::playGame(int index)
+{
+    GameRecord record;
+    record.opening = index / 2;
+    record.firstColor = (index % 2 == 0) ? White : Black;
+
+    std::unique_ptr<ChessBoard> referee = playOpening(record.opening);
+    std::unique_ptr<ChessBoard> boards[2];
+    std::unique_ptr<Search> searches[2];
+    for (int e = 0; e < 2; ++e) {
+        // The copy carries the start board's network, if any, which is not
+        // necessarily the engine's.
+        boards[e] = referee->clone();
+        boards[e]->setNeuralNetwork(engines[e].network);
+        searches[e].reset(new Search(*boards[e]));
+        configure(*searches[e], engines[e]);
+        searches[e]->setNodeLimit(settings.nodesPerMove);
+    }
+
+    for (;;) {
+        record.status = referee->getGameStatus();
+        if (record.status != InProgress || record.plies >= settings.maxPlies) break;
+
+        int e = (referee->getTurn() == record.firstColor) ? 0 : 1;
+        auto begin = std::chrono::steady_clock::now();
+        if (settings.secondsPerMove > 0.0) {
+            auto budget = std::chrono::duration<double>(settings.secondsPerMove);
+            searches[e]->setDeadline(begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(budget));
+        }
+        SearchResult result = searches[e]->search(settings.depth);
+        record.nodes[e] += result.nodes;
+        record.searchSeconds[e] += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        // A search stopped before finishing any root move still has to move.
+        Move m = result.bestMove;
+        if (!m.isValid() && !boards[e]->getAllLegalMoves().empty()) m = boards[e]->getAllLegalMoves()[0];
+        if (!m.isValid() || !referee->movePiece(m.fromRow, m.fromColumn, m.toRow, m.toColumn)) {
+            record.forfeit = true;
+            record.score = (e == 0) ? 0.0 : 1.0;
+            return record;
+        }
+        for (std::unique_ptr<ChessBoard> &board : boards) board->movePiece(m.fromRow, m.fromColumn, m.toRow, m.toColumn);
+        ++record.plies;
+    }
+
+    if (record.status == Checkmate) record.score = (referee->getTurn() == record.firstColor) ? 0.0 : 1.0;
+    else record.score = 0.5;
+    return record;
+}
+
+TournamentResult Tournament::run()
+{
+    TournamentResult result;
+    if (!valid) return result;
+    int numGames = std::max(settings.numGames, 0);
+    result.games.resize(numGames);
+
+    auto begin = std::chrono::steady_clock::now();
+    ThreadPool pool(settings.numThreads);
+    pool.run(size_t(numGames), [&](size_t i) { result.games[i] = playGame(int(i)); });
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    uint64_t nodes[2] = {0, 0};
+    double seconds[2] = {0.0, 0.0};
+    for (const GameRecord &g : result.games) {
+        if (g.score == 1.0) ++result.wins;
+        else if (g.score == 0.0) ++result.losses;
+        else ++result.draws;
+        for (int e = 0; e < 2; ++e) {
+            nodes[e] += g.nodes[e];
+            seconds[e] += g.searchSeconds[e];
+        }
+    }
+    for (int e = 0; e < 2; ++e)
+        result.nodesPerSecond[e] = seconds[e] > 0.0 ? double(nodes[e]) / seconds[e] : 0.0;
+    result.gamesPerSecond = result.seconds > 0.0 ? numGames / result.seconds : 0.0;
+    result.elo = computeElo(result.wins, result.draws, result.losses, result.eloError);
+    return result;
+}
+
+double Tournament::computeElo(int wins, int draws, int losses, double &eloError)
+{
+    eloError = 0.0;
+    int n = wins + draws + losses;
+    if (n == 0) return 0.0;
+
+    // Mean and spread of the per-game scores.
+    double score = (wins + 0.5 * draws) / n;
+    double variance = (wins * (1.0 - score) * (1.0 - score) + draws * (0.5 - score) * (0.5 - score) +
+                       losses * score * score) / n;
+    double error = std::sqrt(variance / n);
+
+    auto elo = [](double s) {
+        s = std::min(std::max(s, ScoreClamp), 1.0 - ScoreClamp);
+        return 400.0 * std::log10(s / (1.0 - s));
+    };
+    eloError = (elo(score + Confidence * error) - elo(score - Confidence * error)) / 2.0;
+    return elo(score);
+}
@@ -0,0 +1,170 @@
+#ifndef __TOURNAMENT_H__
+#define __TOURNAMENT_H__
+
+#include "Chess.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Student
+{
+    class ChessBoard;
+    class NeuralNetwork;
+    class Search;
+
+    /**
+     * @brief
+     * One side of a tournament: which of Search's techniques it uses and
+     * how it scores positions.
+     */
+    struct EngineConfig
+    {
+        std::string name;
+        bool moveOrdering = true;
+        bool stagedGeneration = true;
+        bool quiescence = true;
+        bool nullMovePruning = true;
+        bool lateMoveReductions = true;
+        bool futilityPruning = true;
+        bool exchangePruning = true;
+        // Scores positions instead of the material formula if set; it must
+        // be loaded and made for the start position's board size. Not owned.
+        NeuralNetwork *network = nullptr;
+    };
+
+    /**
+     * @brief
+     * How a tournament is played. Every search stops at whichever of the
+     * depth, node and time limits it reaches first.
+     */
+    struct TournamentSettings
+    {
+        // Games in all; each opening is played twice, colours swapped.
+        int numGames = 100;
+        // Random moves played from the start position to make the openings.
+        int openingPlies = 8;
+        uint32_t seed = 1;
+        int depth = 64;
+        // Nodes per move, or 0 for no limit. Fixed nodes make every game
+        // reproducible from the seed.
+        uint64_t nodesPerMove = 20000;
+        // Seconds per move, or 0 for no limit.
+        double secondsPerMove = 0.0;
+        // Games still going after this many plies are drawn.
+        int maxPlies = 300;
+        // Threads, one game each at a time; 0 for one per core.
+        unsigned numThreads = 0;
+    };
+
+    /**
+     * @brief
+     * One game of a tournament, from the first engine's point of view.
+     */
+    struct GameRecord
+    {
+        int opening = 0;
+        // Colour the first engine played.
+        Color firstColor = White;
+        // 1 for a win of the first engine, 0.5 for a draw, 0 for a loss.
+        double score = 0.5;
+        // How the game ended; InProgress when it was drawn at maxPlies.
+        GameStatus status = InProgress;
+        // Set when an engine had no move or its move was refused, which
+        // loses the game.
+        bool forfeit = false;
+        int plies = 0;
+        // Per engine, the first engine's first.
+        uint64_t nodes[2] = {0, 0};
+        double searchSeconds[2] = {0.0, 0.0};
+
+        /**
+         * @return
+         * Nodes per second of an engine's searches in this game, 0 for the
+         * first engine and 1 for the second.
+         */
+        double getNodesPerSecond(int engine) const
+        {
+            return searchSeconds[engine] > 0.0 ? double(nodes[engine]) / searchSeconds[engine] : 0.0;
+        }
+    };
+
+    /**
+     * @brief
+     * Totals of a tournament, from the first engine's point of view.
+     */
+    struct TournamentResult
+    {
+        int wins = 0;
+        int draws = 0;
+        int losses = 0;
+        // Elo difference of the first engine over the second, and the half
+        // width of its 95% confidence interval. A score of 0 or 1 is taken
+        // as 0.1% or 99.9%.
+        double elo = 0.0;
+        double eloError = 0.0;
+        double seconds = 0.0;
+        double gamesPerSecond = 0.0;
+        // Nodes per second of search, per engine, over all games.
+        double nodesPerSecond[2] = {0.0, 0.0};
+        // In the order the games were scheduled, not finished.
+        std::vector<GameRecord> games;
+    };
+
+    /**
+     * @brief
+     * Plays two engine configurations against each other over many games
+     * at once, to check that a change does not cost playing strength.
+     * Openings are random moves from a start position, drawn from the seed,
+     * and each is played once with either engine as White. Moves are played
+     * with movePiece on a referee board, whose getGameStatus decides when a
+     * game is over; each engine searches a board of its own.
+     */
+    class Tournament
+    {
+    private:
+        ChessBoard &start;
+        EngineConfig engines[2];
+        TournamentSettings settings;
+        bool valid = true;
+
+        static void configure(Search &search, const EngineConfig &config);
+        // A copy of the start position with an opening's moves played.
+        std::unique_ptr<ChessBoard> playOpening(int opening);
+        GameRecord playGame(int index);
+
+    public:
+        /**
+         * @brief
+         * Sets up a tournament.
+         * @param start
+         * Position every opening starts from. Only read, also while games
+         * run; must outlive the tournament.
+         */
+        Tournament(ChessBoard &start, const EngineConfig &first, const EngineConfig &second,
+                   const TournamentSettings &settings);
+
+        /**
+         * @return
+         * Returns false if an engine's network cannot be used on the start
+         * position's board, in which case run plays no games.
+         */
+        bool isValid() { return valid; }
+
+        /**
+         * @brief
+         * Plays every game and waits for them to finish.
+         */
+        TournamentResult run();
+
+        /**
+         * @brief
+         * Turns a score into an Elo difference with a 95% error bar.
+         * @param eloError
+         * Set to the half width of the interval.
+         */
+        static double computeElo(int wins, int draws, int losses, double &eloError);
+    };
+}
+
+#endif